@@ -0,0 +1,247 @@
+#include "alloc_profiler.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+std::atomic<bool> allocation_profiling_flag(false);
+
+namespace
+{
+    constexpr int max_depth = 10;
+    constexpr size_t table_size = 4096;
+
+    struct site_entry
+    {
+        uint64_t hash;
+        void* frames[max_depth];
+        int depth;
+        size_t count;
+        size_t bytes;
+    };
+
+    // Fixed-size open-addressing table: recording must not allocate, since
+    // it runs inside operator new. Sites that do not fit go to `overflow`.
+    site_entry table[table_size];
+    site_entry overflow;
+    std::atomic_flag table_lock = ATOMIC_FLAG_INIT;
+
+    thread_local bool in_profiler = false;
+
+    struct lock_guard
+    {
+        lock_guard()
+        {
+            while (table_lock.test_and_set(std::memory_order_acquire))
+            {
+            }
+        }
+
+        ~lock_guard()
+        {
+            table_lock.clear(std::memory_order_release);
+        }
+    };
+
+    struct reentrancy_guard
+    {
+        reentrancy_guard()
+            : was_inside(in_profiler)
+        {
+            in_profiler = true;
+        }
+
+        ~reentrancy_guard()
+        {
+            in_profiler = was_inside;
+        }
+
+        bool const was_inside;
+    };
+
+    uint64_t hash_frames(void* const* frames, int depth)
+    {
+        uint64_t h = 1469598103934665603ull;
+        for (int i = 0; i != depth; ++i)
+        {
+            h ^= reinterpret_cast<uintptr_t>(frames[i]);
+            h *= 1099511628211ull;
+        }
+        return h | 1;
+    }
+
+    std::string symbolize(void* frame)
+    {
+        Dl_info info;
+        if (dladdr(frame, &info) && info.dli_sname)
+        {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            std::string res = status == 0 ? demangled : info.dli_sname;
+            std::free(demangled);
+            // distinct call sites inside one function differ only in the offset
+            char offset[32];
+            std::snprintf(offset, sizeof offset, "+0x%tx",
+                          static_cast<char*>(frame) - static_cast<char*>(info.dli_saddr));
+            return res + offset;
+        }
+
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "%p", frame);
+        std::string res = buf;
+        if (dladdr(frame, &info) && info.dli_fname)
+            res += std::string(" (") + info.dli_fname + ")";
+        return res;
+    }
+
+    // Frames of the profiler and of the operator new replacement itself say
+    // nothing about the call site. Helpers between them may have no
+    // exported name, so everything up to the last operator new goes.
+    size_t first_caller_frame(std::vector<std::string> const& names)
+    {
+        size_t res = 0;
+        for (size_t i = 0; i != names.size(); ++i)
+            if (names[i].compare(0, 12, "operator new") == 0)
+                res = i + 1;
+        return res;
+    }
+
+    char const* report_path = nullptr;
+
+    void report_at_exit()
+    {
+        enable_allocation_profiling(false);
+        std::FILE* out = stderr;
+        if (report_path && std::strcmp(report_path, "1") != 0)
+            out = std::fopen(report_path, "a");
+        if (!out)
+            out = stderr;
+        print_allocation_profile(out);
+        if (out != stderr)
+            std::fclose(out);
+    }
+
+    struct env_initializer
+    {
+        env_initializer()
+        {
+            report_path = std::getenv("DEQUE_ALLOC_PROFILE");
+            if (report_path && *report_path)
+            {
+                enable_allocation_profiling(true);
+                std::atexit(report_at_exit);
+            }
+        }
+    } env_initializer_instance;
+}
+
+void enable_allocation_profiling(bool enable)
+{
+    if (enable)
+    {
+        // the first backtrace() loads the unwinder, which allocates
+        reentrancy_guard g;
+        void* frames[1];
+        backtrace(frames, 1);
+    }
+    allocation_profiling_flag.store(enable, std::memory_order_relaxed);
+}
+
+void reset_allocation_profile()
+{
+    lock_guard lock;
+    std::memset(table, 0, sizeof table);
+    std::memset(&overflow, 0, sizeof overflow);
+}
+
+void record_allocation_site(size_t bytes)
+{
+    if (!allocation_profiling_enabled() || in_profiler)
+        return;
+
+    reentrancy_guard g;
+    void* frames[max_depth];
+    int depth = backtrace(frames, max_depth);
+    uint64_t hash = hash_frames(frames, depth);
+
+    lock_guard lock;
+    for (size_t probe = 0; probe != table_size; ++probe)
+    {
+        site_entry& e = table[(hash + probe) & (table_size - 1)];
+        if (e.hash == 0)
+        {
+            e.hash = hash;
+            std::memcpy(e.frames, frames, depth * sizeof(void*));
+            e.depth = depth;
+        }
+        if (e.hash == hash && e.depth == depth && std::equal(frames, frames + depth, e.frames))
+        {
+            e.count++;
+            e.bytes += bytes;
+            return;
+        }
+    }
+    overflow.count++;
+    overflow.bytes += bytes;
+}
+
+std::vector<allocation_site> allocation_profile()
+{
+    reentrancy_guard g;
+
+    std::vector<site_entry> entries;
+    site_entry overflow_copy;
+    {
+        lock_guard lock;
+        for (site_entry const& e : table)
+            if (e.hash != 0)
+                entries.push_back(e);
+        overflow_copy = overflow;
+    }
+
+    std::vector<allocation_site> res;
+    for (site_entry const& e : entries)
+    {
+        allocation_site site{e.count, e.bytes, {}};
+        for (int i = 0; i != e.depth; ++i)
+            site.frames.push_back(symbolize(e.frames[i]));
+        site.frames.erase(site.frames.begin(), site.frames.begin() + first_caller_frame(site.frames));
+        res.push_back(std::move(site));
+    }
+    if (overflow_copy.count != 0)
+        res.push_back(allocation_site{overflow_copy.count, overflow_copy.bytes, {"<table full>"}});
+
+    std::sort(res.begin(), res.end(), [](allocation_site const& a, allocation_site const& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.count > b.count;
+    });
+    return res;
+}
+
+void print_allocation_profile(std::FILE* out, size_t max_sites)
+{
+    std::vector<allocation_site> sites = allocation_profile();
+
+    size_t total_count = 0, total_bytes = 0;
+    for (allocation_site const& s : sites)
+    {
+        total_count += s.count;
+        total_bytes += s.bytes;
+    }
+
+    std::fprintf(out, "allocation profile: %zu allocations, %zu bytes, %zu call sites\n",
+                 total_count, total_bytes, sites.size());
+    for (size_t i = 0; i != sites.size() && i != max_sites; ++i)
+    {
+        allocation_site const& s = sites[i];
+        std::fprintf(out, "%12zu bytes %9zu allocs %5.1f%%\n", s.bytes, s.count,
+                     total_bytes ? 100.0 * s.bytes / total_bytes : 0.0);
+        for (size_t f = 0; f != s.frames.size() && f != 4; ++f)
+            std::fprintf(out, "        %s %s\n", f ? "<-" : "at", s.frames[f].c_str());
+    }
+    std::fflush(out);
+}
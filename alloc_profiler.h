@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Per-call-site allocation profile collected by the global operator new
+// replacement in fault_injection.cpp. Every allocation made while profiling
+// is on is attributed to the short backtrace that led to it.
+//
+// Setting DEQUE_ALLOC_PROFILE in the environment turns profiling on at
+// startup and prints the report to stderr at exit (or appends it to the
+// file named by the variable, if it is not "1").
+
+struct allocation_site
+{
+    size_t count;
+    size_t bytes;
+    std::vector<std::string> frames;
+};
+
+extern std::atomic<bool> allocation_profiling_flag;
+
+inline bool allocation_profiling_enabled()
+{
+    return allocation_profiling_flag.load(std::memory_order_relaxed);
+}
+
+void enable_allocation_profiling(bool enable);
+void reset_allocation_profile();
+
+// called by operator new; cheap no-op unless profiling is enabled
+void record_allocation_site(size_t bytes);
+
+// sites sorted by bytes, largest first
+std::vector<allocation_site> allocation_profile();
+void print_allocation_profile(std::FILE* out, size_t max_sites = 25);
@@ -0,0 +1,324 @@
+#include "bench_harness.h"
+#include "buffer_cache.h"
+#include "my_deque.h"
+#include "reclaimer.h"
+#include "reference_ring.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using value_type = std::uint64_t;
+
+template<typename C>
+struct container_traits;
+
+template<>
+struct container_traits<my_deque<value_type>> {
+    static constexpr char const *name = "my_deque";
+    static constexpr bool has_front = true;
+    static constexpr bool has_insert = true;
+};
+
+template<>
+struct container_traits<my_deque<value_type, deque_stats_disabled, deque_recycling_storage>> {
+    static constexpr char const *name = "my_deque+recycling";
+    static constexpr bool has_front = true;
+    static constexpr bool has_insert = true;
+};
+
+template<>
+struct container_traits<std::deque<value_type>> {
+    static constexpr char const *name = "std::deque";
+    static constexpr bool has_front = true;
+    static constexpr bool has_insert = true;
+};
+
+template<>
+struct container_traits<std::vector<value_type>> {
+    static constexpr char const *name = "std::vector";
+    static constexpr bool has_front = false;
+    static constexpr bool has_insert = true;
+};
+
+template<>
+struct container_traits<reference_ring<value_type>> {
+    static constexpr char const *name = "ring";
+    static constexpr bool has_front = true;
+    static constexpr bool has_insert = false;
+};
+
+template<typename C>
+C filled(size_t n) {
+    C c;
+    for (size_t i = 0; i != n; ++i) {
+        c.push_back(i);
+    }
+    return c;
+}
+
+std::vector<size_t> random_indices(size_t count, size_t bound) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, bound - 1);
+    std::vector<size_t> res(count);
+    for (size_t &i : res) {
+        i = dist(rng);
+    }
+    return res;
+}
+
+// Insert and erase are O(n) per operation in the middle, so they run on a
+// smaller base container than the O(1) benchmarks.
+size_t const positional_ops = 1000;
+
+double const positions[] = {0.0, 0.25, 0.5, 1.0};
+char const *const position_names[] = {"front", "quarter", "middle", "back"};
+
+template<typename C>
+void run_container(bench::runner &r, size_t n, std::vector<size_t> const &indices) {
+    using traits = container_traits<C>;
+    std::string name = traits::name;
+
+    r.run("push_back", name, n, [n](bench::sample_timer &t) {
+        C c;
+        t.start();
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(i);
+        }
+        t.stop();
+        bench::do_not_optimize(c);
+        return n;
+    });
+
+    r.run("pop_back", name, n, [n](bench::sample_timer &t) {
+        C c = filled<C>(n);
+        value_type sum = 0;
+        t.start();
+        for (size_t i = 0; i != n; ++i) {
+            sum += c.back();
+            c.pop_back();
+        }
+        t.stop();
+        bench::do_not_optimize(sum);
+        return n;
+    });
+
+    if constexpr (traits::has_front) {
+        r.run("push_front", name, n, [n](bench::sample_timer &t) {
+            C c;
+            t.start();
+            for (size_t i = 0; i != n; ++i) {
+                c.push_front(i);
+            }
+            t.stop();
+            bench::do_not_optimize(c);
+            return n;
+        });
+
+        r.run("pop_front", name, n, [n](bench::sample_timer &t) {
+            C c = filled<C>(n);
+            value_type sum = 0;
+            t.start();
+            for (size_t i = 0; i != n; ++i) {
+                sum += c.front();
+                c.pop_front();
+            }
+            t.stop();
+            bench::do_not_optimize(sum);
+            return n;
+        });
+
+        r.run("queue", name, n, [n](bench::sample_timer &t) {
+            C c = filled<C>(n);
+            t.start();
+            for (size_t i = 0; i != n; ++i) {
+                c.push_back(i);
+                c.pop_front();
+            }
+            t.stop();
+            bench::do_not_optimize(c);
+            return n;
+        });
+    }
+
+    // many small containers that live for a few operations, where getting
+    // and returning the buffers dominates
+    r.run("short_lived", name, n, [n](bench::sample_timer &t) {
+        size_t const per_container = 48;
+        size_t rounds = std::max<size_t>(1, n / per_container);
+        t.start();
+        for (size_t round = 0; round != rounds; ++round) {
+            C c;
+            for (size_t i = 0; i != per_container; ++i) {
+                c.push_back(i);
+            }
+            bench::do_not_optimize(c);
+        }
+        t.stop();
+        return rounds * per_container;
+    });
+
+    r.run("random_access", name, n, [n, &indices](bench::sample_timer &t) {
+        C c = filled<C>(n);
+        value_type sum = 0;
+        t.start();
+        for (size_t i : indices) {
+            sum += c[i];
+        }
+        t.stop();
+        bench::do_not_optimize(sum);
+        return indices.size();
+    });
+
+    r.run("iterate", name, n, [n](bench::sample_timer &t) {
+        C const c = filled<C>(n);
+        value_type sum = 0;
+        t.start();
+        for (value_type v : c) {
+            sum += v;
+        }
+        t.stop();
+        bench::do_not_optimize(sum);
+        return n;
+    });
+
+    r.run("copy", name, n, [n](bench::sample_timer &t) {
+        C c = filled<C>(n);
+        t.start();
+        auto copy = std::make_unique<C>(c);
+        t.stop();
+        bench::do_not_optimize(*copy);
+        return n;
+    });
+
+    r.run("growth_cycle", name, n, [n](bench::sample_timer &t) {
+        C c;
+        t.start();
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(i);
+        }
+        for (size_t i = 0; i != n - n / 8; ++i) {
+            c.pop_back();
+        }
+        for (size_t i = n / 8; i != n; ++i) {
+            c.push_back(i);
+        }
+        t.stop();
+        bench::do_not_optimize(c);
+        return 3 * n - 2 * (n / 8);
+    });
+
+    if constexpr (traits::has_insert) {
+        size_t base = std::min<size_t>(n, 10000);
+        for (size_t p = 0; p != sizeof(positions) / sizeof(positions[0]); ++p) {
+            double frac = positions[p];
+            r.run(std::string("insert_") + position_names[p], name, base, [base, frac](bench::sample_timer &t) {
+                C c = filled<C>(base);
+                t.start();
+                for (size_t i = 0; i != positional_ops; ++i) {
+                    c.insert(c.begin() + static_cast<ptrdiff_t>(frac * c.size()), i);
+                }
+                t.stop();
+                bench::do_not_optimize(c);
+                return positional_ops;
+            });
+
+            r.run(std::string("erase_") + position_names[p], name, base, [base, frac](bench::sample_timer &t) {
+                C c = filled<C>(base + positional_ops);
+                t.start();
+                for (size_t i = 0; i != positional_ops; ++i) {
+                    size_t at = std::min(static_cast<size_t>(frac * c.size()), c.size() - 1);
+                    c.erase(c.begin() + static_cast<ptrdiff_t>(at));
+                }
+                t.stop();
+                bench::do_not_optimize(c);
+                return positional_ops;
+            });
+        }
+    }
+}
+
+// Dropping a deque of heap-owning elements: the time the caller waits,
+// destroying everything itself or handing the deque to a reclaimer.
+void run_reclaim(bench::runner &r, size_t n) {
+    using heavy = std::string;
+    auto fill = [n] {
+        my_deque<heavy> c;
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(heavy(40, char('a' + i % 26)));
+        }
+        return c;
+    };
+
+    r.run("clear_heavy", "my_deque", n, [&fill, n](bench::sample_timer &t) {
+        my_deque<heavy> c = fill();
+        t.start();
+        c.clear();
+        c.shrink_to_fit();
+        t.stop();
+        return n;
+    });
+
+    background_reclaimer reclaimer;
+    r.run("clear_heavy", "my_deque+reclaimer", n, [&fill, &reclaimer, n](bench::sample_timer &t) {
+        my_deque<heavy> c = fill();
+        t.start();
+        reclaimer.retire(c);
+        t.stop();
+        reclaimer.drain();
+        return n;
+    });
+}
+
+}
+
+int main(int argc, char **argv) {
+    bench::options opts;
+    if (!bench::parse_options(argc, argv, opts)) {
+        return 1;
+    }
+    if (opts.latency) {
+        return bench::run_latency_suite(opts);
+    }
+    if (opts.memory) {
+        return bench::run_memory_suite(opts);
+    }
+    if (opts.numa) {
+        return bench::run_numa_suite(opts);
+    }
+
+    bench::runner r(opts);
+    size_t n = opts.size;
+    std::vector<size_t> indices = random_indices(n, n);
+
+    run_container<my_deque<value_type>>(r, n, indices);
+    run_container<my_deque<value_type, deque_stats_disabled, deque_recycling_storage>>(r, n, indices);
+    run_container<std::deque<value_type>>(r, n, indices);
+    run_container<std::vector<value_type>>(r, n, indices);
+    run_container<reference_ring<value_type>>(r, n, indices);
+    run_reclaim(r, n);
+
+    if (opts.list_only) {
+        return 0;
+    }
+
+    r.print_table(std::cout);
+    if (opts.json_path == "-") {
+        r.write_json(std::cout);
+    } else if (!opts.json_path.empty()) {
+        std::ofstream out(opts.json_path);
+        r.write_json(out);
+        if (!out) {
+            std::cerr << "failed to write " << opts.json_path << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "bench_harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+namespace bench {
+
+namespace {
+
+// Two-sided 95% Student t quantiles for 1..30 degrees of freedom.
+double const t_quantiles[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+double t_quantile(size_t degrees_of_freedom) {
+    if (degrees_of_freedom == 0) {
+        return 0;
+    }
+    if (degrees_of_freedom <= 30) {
+        return t_quantiles[degrees_of_freedom - 1];
+    }
+    return 1.96;
+}
+
+void write_json_string(std::ostream &out, std::string const &s) {
+    out << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+bool parse_value(char const *arg, char const *name, char const *&value) {
+    size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+}
+
+summary summarize(std::vector<double> samples) {
+    summary s;
+    if (samples.empty()) {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    s.min = samples.front();
+    s.max = samples.back();
+    s.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    s.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    if (n > 1) {
+        double sq = 0;
+        for (double v : samples) {
+            sq += (v - s.mean) * (v - s.mean);
+        }
+        s.stddev = std::sqrt(sq / (n - 1));
+        s.ci95 = t_quantile(n - 1) * s.stddev / std::sqrt(double(n));
+    }
+    return s;
+}
+
+bool parse_options(int argc, char **argv, options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        char const *arg = argv[i];
+        char const *value;
+        if (parse_value(arg, "--reps", value)) {
+            opts.repetitions = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (parse_value(arg, "--min-time-ms", value)) {
+            opts.min_rep_ms = std::strtod(value, nullptr);
+        } else if (parse_value(arg, "--size", value)) {
+            opts.size = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (parse_value(arg, "--filter", value)) {
+            opts.filter = value;
+        } else if (parse_value(arg, "--json", value)) {
+            opts.json_path = value;
+        } else if (std::strcmp(arg, "--list") == 0) {
+            opts.list_only = true;
+        } else if (std::strcmp(arg, "--no-perf") == 0) {
+            opts.perf = false;
+        } else if (std::strcmp(arg, "--latency") == 0) {
+            opts.latency = true;
+        } else if (std::strcmp(arg, "--memory") == 0) {
+            opts.memory = true;
+        } else if (std::strcmp(arg, "--numa") == 0) {
+            opts.numa = true;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--reps=N] [--min-time-ms=MS] [--size=N] [--filter=SUBSTR] [--json=FILE|-] [--list] [--no-perf] [--latency] [--memory] [--numa]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+runner::runner(options opts) : opts_(std::move(opts)) {
+    if (!opts_.perf || opts_.list_only) {
+        return;
+    }
+    counters_.reset(new perf_counters());
+    if (!counters_->any_available()) {
+        std::cerr << "hardware counters unavailable (" << counters_->error() << "), reporting time only\n";
+        counters_.reset();
+    } else if (!counters_->error().empty()) {
+        std::cerr << "some hardware counters unavailable (" << counters_->error() << ")\n";
+    }
+}
+
+bool runner::enabled(std::string const &benchmark, std::string const &container) const {
+    std::string id = benchmark + "/" + container;
+    if (opts_.list_only) {
+        std::cout << id << '\n';
+        return false;
+    }
+    return opts_.filter.empty() || id.find(opts_.filter) != std::string::npos;
+}
+
+void runner::add(result r) {
+    r.ns = summarize(r.ns_per_op);
+    for (int k = 0; k != perf_event_count; ++k) {
+        r.counter_median[k] = summarize(r.counter_per_op[k]).median;
+    }
+    std::cerr << std::left << std::setw(24) << r.benchmark << std::setw(20) << r.container
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << r.ns.median << " ns/op  +- " << r.ns.ci95 << '\n';
+    results_.push_back(std::move(r));
+}
+
+void runner::print_table(std::ostream &out) const {
+    out << std::left << std::setw(24) << "benchmark" << std::setw(20) << "container"
+        << std::right << std::setw(12) << "median" << std::setw(12) << "mean"
+        << std::setw(12) << "stddev" << std::setw(12) << "ci95" << std::setw(12) << "min";
+    if (counters_) {
+        for (int k = 0; k != perf_event_count; ++k) {
+            out << std::setw(15) << perf_counters::name(static_cast<perf_event_kind>(k));
+        }
+    }
+    out << '\n';
+    for (result const &r : results_) {
+        out << std::left << std::setw(24) << r.benchmark << std::setw(20) << r.container
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << r.ns.median << std::setw(12) << r.ns.mean
+            << std::setw(12) << r.ns.stddev << std::setw(12) << r.ns.ci95
+            << std::setw(12) << r.ns.min;
+        if (counters_) {
+            for (int k = 0; k != perf_event_count; ++k) {
+                if (r.counter_per_op[k].empty()) {
+                    out << std::setw(15) << "-";
+                } else {
+                    out << std::setw(15) << r.counter_median[k];
+                }
+            }
+        }
+        out << '\n';
+    }
+}
+
+void runner::write_json(std::ostream &out) const {
+    out << "{\n  \"repetitions\": " << opts_.repetitions
+        << ",\n  \"min_rep_ms\": " << opts_.min_rep_ms
+        << ",\n  \"results\": [";
+    bool first = true;
+    for (result const &r : results_) {
+        out << (first ? "\n" : ",\n") << "    {\"benchmark\": ";
+        write_json_string(out, r.benchmark);
+        out << ", \"container\": ";
+        write_json_string(out, r.container);
+        out << ", \"size\": " << r.size
+            << ", \"ops_per_rep\": " << r.ops_per_rep
+            << std::setprecision(4) << std::fixed
+            << ", \"ns_per_op\": {\"median\": " << r.ns.median
+            << ", \"mean\": " << r.ns.mean
+            << ", \"stddev\": " << r.ns.stddev
+            << ", \"ci95\": " << r.ns.ci95
+            << ", \"min\": " << r.ns.min
+            << ", \"max\": " << r.ns.max
+            << ", \"samples\": [";
+        for (size_t i = 0; i != r.ns_per_op.size(); ++i) {
+            out << (i ? ", " : "") << r.ns_per_op[i];
+        }
+        out << "]}, \"counters_per_op\": {";
+        for (int k = 0; k != perf_event_count; ++k) {
+            out << (k ? ", " : "") << '"' << perf_counters::name(static_cast<perf_event_kind>(k)) << "\": ";
+            if (r.counter_per_op[k].empty()) {
+                out << "null";
+            } else {
+                out << r.counter_median[k];
+            }
+        }
+        out << "}}";
+        first = false;
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "perf_counters.h"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+template<typename T>
+inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+// Handed to every benchmark body. The body does its setup, brackets the
+// measured part with start()/stop() and returns the number of operations
+// it performed inside that bracket. Hardware counters, when the runner has
+// them, are enabled only inside the same bracket.
+struct sample_timer {
+    explicit sample_timer(perf_counters *counters = nullptr) : counters_(counters) {}
+
+    void start() {
+        if (counters_) {
+            counters_->enable();
+        }
+        clobber_memory();
+        started_ = std::chrono::steady_clock::now();
+    }
+
+    void stop() {
+        auto finished = std::chrono::steady_clock::now();
+        clobber_memory();
+        if (counters_) {
+            counters_->disable();
+        }
+        elapsed_ns_ += std::chrono::duration<double, std::nano>(finished - started_).count();
+    }
+
+    double elapsed_ns() const {
+        return elapsed_ns_;
+    }
+
+private:
+    perf_counters *counters_;
+    std::chrono::steady_clock::time_point started_;
+    double elapsed_ns_ = 0;
+};
+
+struct summary {
+    double mean = 0;
+    double median = 0;
+    double stddev = 0;
+    double min = 0;
+    double max = 0;
+    double ci95 = 0;
+};
+
+summary summarize(std::vector<double> samples);
+
+struct result {
+    std::string benchmark;
+    std::string container;
+    size_t size = 0;
+    size_t ops_per_rep = 0;
+    std::vector<double> ns_per_op;
+    summary ns;
+    // per-operation hardware counts, one sample per repetition; empty when
+    // the counter is unavailable
+    std::array<std::vector<double>, perf_event_count> counter_per_op;
+    perf_values counter_median{};
+};
+
+struct options {
+    size_t repetitions = 15;
+    double min_rep_ms = 20;
+    size_t size = 100000;
+    std::string filter;
+    std::string json_path;
+    bool list_only = false;
+    bool perf = true;
+    bool latency = false;
+    bool memory = false;
+    bool numa = false;
+};
+
+bool parse_options(int argc, char **argv, options &opts);
+
+// Per-operation latency percentiles instead of throughput; see bench_latency.cpp.
+int run_latency_suite(options const &opts);
+
+// Bytes held per element after fill/drain/oscillate workloads; see bench_memory.cpp.
+int run_memory_suite(options const &opts);
+
+// Reading deques placed on the consumer's NUMA node or another; see bench_numa.cpp.
+int run_numa_suite(options const &opts);
+
+class runner {
+public:
+    explicit runner(options opts);
+
+    options const &opts() const {
+        return opts_;
+    }
+
+    bool enabled(std::string const &benchmark, std::string const &container) const;
+
+    // body: size_t(sample_timer &). It is called repeatedly; each repetition
+    // runs it enough times to last at least min_rep_ms, after one warm-up call.
+    template<typename F>
+    void run(std::string const &benchmark, std::string const &container, size_t size, F &&body);
+
+    std::vector<result> const &results() const {
+        return results_;
+    }
+
+    void print_table(std::ostream &out) const;
+    void write_json(std::ostream &out) const;
+
+private:
+    void add(result r);
+
+    options opts_;
+    std::unique_ptr<perf_counters> counters_;
+    std::vector<result> results_;
+};
+
+template<typename F>
+void runner::run(std::string const &benchmark, std::string const &container, size_t size, F &&body) {
+    if (!enabled(benchmark, container)) {
+        return;
+    }
+
+    result r;
+    r.benchmark = benchmark;
+    r.container = container;
+    r.size = size;
+
+    size_t inner = 1;
+    {
+        sample_timer warmup;
+        r.ops_per_rep = body(warmup);
+        double min_ns = opts_.min_rep_ms * 1e6;
+        if (warmup.elapsed_ns() > 0 && warmup.elapsed_ns() < min_ns) {
+            inner = static_cast<size_t>(min_ns / warmup.elapsed_ns()) + 1;
+        }
+    }
+
+    for (size_t rep = 0; rep != opts_.repetitions; ++rep) {
+        if (counters_) {
+            counters_->reset();
+        }
+        sample_timer timer(counters_.get());
+        size_t ops = 0;
+        for (size_t i = 0; i != inner; ++i) {
+            ops += body(timer);
+        }
+        r.ns_per_op.push_back(ops == 0 ? 0 : timer.elapsed_ns() / ops);
+        if (counters_) {
+            perf_values values = counters_->read();
+            for (int k = 0; k != perf_event_count; ++k) {
+                if (counters_->available(static_cast<perf_event_kind>(k))) {
+                    r.counter_per_op[k].push_back(ops == 0 ? 0 : values[k] / ops);
+                }
+            }
+        }
+    }
+    add(std::move(r));
+}
+
+}
@@ -0,0 +1,162 @@
+#include "bench_harness.h"
+#include "latency_histogram.h"
+#include "incremental_deque.h"
+#include "my_deque.h"
+#include "reference_ring.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+using value_type = std::uint64_t;
+
+struct latency_result {
+    std::string workload;
+    std::string container;
+    latency_histogram ticks;
+};
+
+double const reported_percentiles[] = {0.5, 0.9, 0.99, 0.999, 0.9999};
+char const *const percentile_names[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+size_t const percentile_count = sizeof(reported_percentiles) / sizeof(reported_percentiles[0]);
+
+// Every operation is timed on its own, so the histogram keeps the stalls
+// that an average over a whole sweep hides: the one push out of n that
+// reallocates and relocates the entire container.
+template<typename C, bool has_front>
+void sweep(std::vector<latency_result> &out, char const *name, size_t n, size_t sweeps) {
+    latency_result push_back{"push_back", name, {}};
+    latency_result pop_back{"pop_back", name, {}};
+    latency_result push_front{"push_front", name, {}};
+    latency_result pop_front{"pop_front", name, {}};
+
+    for (size_t s = 0; s != sweeps; ++s) {
+        {
+            C c;
+            for (size_t i = 0; i != n; ++i) {
+                uint64_t t0 = latency_ticks();
+                c.push_back(i);
+                uint64_t t1 = latency_ticks();
+                push_back.ticks.record(t1 - t0);
+            }
+            for (size_t i = 0; i != n; ++i) {
+                uint64_t t0 = latency_ticks();
+                c.pop_back();
+                uint64_t t1 = latency_ticks();
+                pop_back.ticks.record(t1 - t0);
+            }
+            do_not_optimize(c);
+        }
+        if constexpr (has_front) {
+            C c;
+            for (size_t i = 0; i != n; ++i) {
+                uint64_t t0 = latency_ticks();
+                c.push_front(i);
+                uint64_t t1 = latency_ticks();
+                push_front.ticks.record(t1 - t0);
+            }
+            for (size_t i = 0; i != n; ++i) {
+                uint64_t t0 = latency_ticks();
+                c.pop_front();
+                uint64_t t1 = latency_ticks();
+                pop_front.ticks.record(t1 - t0);
+            }
+            do_not_optimize(c);
+        }
+    }
+
+    out.push_back(std::move(push_back));
+    out.push_back(std::move(pop_back));
+    if (has_front) {
+        out.push_back(std::move(push_front));
+        out.push_back(std::move(pop_front));
+    }
+}
+
+bool selected(options const &opts, char const *container) {
+    return opts.filter.empty() || std::string(container).find(opts.filter) != std::string::npos;
+}
+
+}
+
+int run_latency_suite(options const &opts) {
+    size_t n = opts.size;
+    size_t sweeps = opts.repetitions;
+    std::vector<latency_result> results;
+
+    latency_result overhead{"timer_overhead", "-", {}};
+    for (size_t i = 0; i != n; ++i) {
+        uint64_t t0 = latency_ticks();
+        uint64_t t1 = latency_ticks();
+        overhead.ticks.record(t1 - t0);
+    }
+    results.push_back(std::move(overhead));
+
+    if (selected(opts, "my_deque")) {
+        sweep<my_deque<value_type>, true>(results, "my_deque", n, sweeps);
+    }
+    if (selected(opts, "incremental_deque")) {
+        sweep<incremental_deque<value_type>, true>(results, "incremental_deque", n, sweeps);
+    }
+    if (selected(opts, "std::deque")) {
+        sweep<std::deque<value_type>, true>(results, "std::deque", n, sweeps);
+    }
+    if (selected(opts, "std::vector")) {
+        sweep<std::vector<value_type>, false>(results, "std::vector", n, sweeps);
+    }
+    if (selected(opts, "ring")) {
+        sweep<reference_ring<value_type>, true>(results, "ring", n, sweeps);
+    }
+
+    double scale = 1.0 / ticks_per_ns();
+
+    std::cout << std::left << std::setw(16) << "workload" << std::setw(19) << "container" << std::right;
+    for (char const *p : percentile_names) {
+        std::cout << std::setw(11) << p;
+    }
+    std::cout << std::setw(13) << "max" << std::setw(11) << "mean" << "   (ns)\n";
+    for (latency_result const &r : results) {
+        std::cout << std::left << std::setw(16) << r.workload << std::setw(19) << r.container
+                  << std::right << std::fixed << std::setprecision(1);
+        for (double q : reported_percentiles) {
+            std::cout << std::setw(11) << r.ticks.percentile(q) * scale;
+        }
+        std::cout << std::setw(13) << r.ticks.max() * scale << std::setw(11) << r.ticks.mean() * scale << '\n';
+    }
+
+    if (opts.json_path.empty()) {
+        return 0;
+    }
+    std::ofstream file;
+    std::ostream *out = &std::cout;
+    if (opts.json_path != "-") {
+        file.open(opts.json_path);
+        out = &file;
+    }
+    *out << "{\n  \"size\": " << n << ",\n  \"sweeps\": " << sweeps
+         << ",\n  \"ticks_per_ns\": " << ticks_per_ns() << ",\n  \"results\": [";
+    for (size_t i = 0; i != results.size(); ++i) {
+        latency_result const &r = results[i];
+        *out << (i ? ",\n" : "\n") << "    {\"workload\": \"" << r.workload << "\", \"container\": \""
+             << r.container << "\", \"count\": " << r.ticks.count() << ", \"ns\": {";
+        for (size_t p = 0; p != percentile_count; ++p) {
+            *out << '"' << percentile_names[p] << "\": " << r.ticks.percentile(reported_percentiles[p]) * scale << ", ";
+        }
+        *out << "\"max\": " << r.ticks.max() * scale << ", \"mean\": " << r.ticks.mean() * scale << "}}";
+    }
+    *out << "\n  ]\n}\n";
+    if (!*out) {
+        std::cerr << "failed to write " << opts.json_path << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+}
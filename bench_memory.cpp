@@ -0,0 +1,196 @@
+#include "bench_harness.h"
+#include "fault_injection.h"
+#include "incremental_deque.h"
+#include "my_deque.h"
+#include "reference_ring.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+
+namespace bench {
+
+namespace {
+
+using value_type = std::uint64_t;
+
+struct memory_result {
+    std::string pattern;
+    std::string container;
+    size_t elements = 0;
+    size_t held_bytes = 0;
+    size_t peak_bytes = 0;
+    size_t allocations = 0;
+    long rss_delta_bytes = 0;
+    bool has_breakdown = false;
+    my_deque_memory breakdown;
+};
+
+long resident_bytes() {
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (!f) {
+        return 0;
+    }
+    long pages = 0, resident = 0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    std::fclose(f);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+template<typename C>
+void breakdown(memory_result &, C const &) {}
+
+template<typename T, typename S, typename A>
+void breakdown(memory_result &r, my_deque<T, S, A> const &c) {
+    r.has_breakdown = true;
+    r.breakdown = c.memory_usage();
+}
+
+// Runs one workload on a fresh container and records what it holds at the
+// end, relative to what was allocated before it started.
+template<typename C, typename F>
+memory_result measure(char const *pattern, char const *name, F &&workload) {
+    memory_result r;
+    r.pattern = pattern;
+    r.container = name;
+
+    allocation_stats before = get_allocation_stats();
+    reset_peak_allocation();
+    long rss_before = resident_bytes();
+    {
+        C c;
+        r.elements = workload(c);
+        allocation_stats after = get_allocation_stats();
+        r.held_bytes = after.live_bytes - before.live_bytes;
+        r.peak_bytes = after.peak_bytes - before.live_bytes;
+        r.allocations = after.allocations - before.allocations;
+        r.rss_delta_bytes = resident_bytes() - rss_before;
+        breakdown(r, c);
+        do_not_optimize(c);
+    }
+    return r;
+}
+
+template<typename C>
+void run_patterns(std::vector<memory_result> &out, char const *name, size_t n) {
+    out.push_back(measure<C>("fill", name, [n](C &c) {
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(i);
+        }
+        return n;
+    }));
+
+    out.push_back(measure<C>("drain", name, [n](C &c) {
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(i);
+        }
+        while (c.size() > n / 16) {
+            c.pop_back();
+        }
+        return c.size();
+    }));
+
+    out.push_back(measure<C>("oscillate", name, [n](C &c) {
+        for (size_t i = 0; i != n; ++i) {
+            c.push_back(i);
+        }
+        for (int cycle = 0; cycle != 8; ++cycle) {
+            while (c.size() > n / 4) {
+                c.pop_back();
+            }
+            while (c.size() < n) {
+                c.push_back(cycle);
+            }
+        }
+        while (c.size() > n / 2) {
+            c.pop_back();
+        }
+        return c.size();
+    }));
+}
+
+bool selected(options const &opts, char const *container) {
+    return opts.filter.empty() || std::string(container).find(opts.filter) != std::string::npos;
+}
+
+}
+
+int run_memory_suite(options const &opts) {
+    size_t n = opts.size;
+    std::vector<memory_result> results;
+
+    enable_allocation_tracking(true);
+    if (selected(opts, "my_deque")) {
+        run_patterns<my_deque<value_type>>(results, "my_deque", n);
+    }
+    if (selected(opts, "incremental_deque")) {
+        run_patterns<incremental_deque<value_type>>(results, "incremental_deque", n);
+    }
+    if (selected(opts, "std::deque")) {
+        run_patterns<std::deque<value_type>>(results, "std::deque", n);
+    }
+    if (selected(opts, "std::vector")) {
+        run_patterns<std::vector<value_type>>(results, "std::vector", n);
+    }
+    if (selected(opts, "ring")) {
+        run_patterns<reference_ring<value_type>>(results, "ring", n);
+    }
+    enable_allocation_tracking(false);
+
+    std::cout << std::left << std::setw(11) << "pattern" << std::setw(19) << "container" << std::right
+              << std::setw(10) << "elements" << std::setw(13) << "held" << std::setw(13) << "peak"
+              << std::setw(12) << "bytes/elem" << std::setw(8) << "allocs" << std::setw(13) << "rss_delta"
+              << "   my_deque payload/slack/header\n";
+    for (memory_result const &r : results) {
+        std::cout << std::left << std::setw(11) << r.pattern << std::setw(19) << r.container << std::right
+                  << std::setw(10) << r.elements << std::setw(13) << r.held_bytes << std::setw(13) << r.peak_bytes
+                  << std::setw(12) << std::fixed << std::setprecision(2)
+                  << (r.elements ? double(r.held_bytes) / r.elements : 0.0)
+                  << std::setw(8) << r.allocations << std::setw(13) << r.rss_delta_bytes;
+        if (r.has_breakdown) {
+            std::cout << "   " << r.breakdown.payload_bytes << '/' << r.breakdown.slack_bytes << '/'
+                      << r.breakdown.header_bytes;
+        }
+        std::cout << '\n';
+    }
+
+    if (opts.json_path.empty()) {
+        return 0;
+    }
+    std::ofstream file;
+    std::ostream *out = &std::cout;
+    if (opts.json_path != "-") {
+        file.open(opts.json_path);
+        out = &file;
+    }
+    *out << "{\n  \"size\": " << n << ",\n  \"element_bytes\": " << sizeof(value_type) << ",\n  \"results\": [";
+    for (size_t i = 0; i != results.size(); ++i) {
+        memory_result const &r = results[i];
+        *out << (i ? ",\n" : "\n") << "    {\"pattern\": \"" << r.pattern << "\", \"container\": \"" << r.container
+             << "\", \"elements\": " << r.elements << ", \"held_bytes\": " << r.held_bytes
+             << ", \"peak_bytes\": " << r.peak_bytes << ", \"allocations\": " << r.allocations
+             << ", \"rss_delta_bytes\": " << r.rss_delta_bytes;
+        if (r.has_breakdown) {
+            *out << ", \"payload_bytes\": " << r.breakdown.payload_bytes
+                 << ", \"slack_bytes\": " << r.breakdown.slack_bytes
+                 << ", \"header_bytes\": " << r.breakdown.header_bytes;
+        }
+        *out << '}';
+    }
+    *out << "\n  ]\n}\n";
+    if (!*out) {
+        std::cerr << "failed to write " << opts.json_path << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,117 @@
+#include "bench_harness.h"
+#include "my_deque.h"
+#include "numa_storage.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace bench {
+
+namespace {
+
+using value_type = std::uint64_t;
+using numa_deque = my_deque<value_type, deque_stats_disabled, deque_numa_storage>;
+
+numa_deque filled_on(int node, size_t n) {
+    numa::placement_scope scope(node);
+    numa_deque c;
+    for (size_t i = 0; i != n; ++i) {
+        c.push_back(i);
+    }
+    return c;
+}
+
+// home is where the deque is first filled; it is then moved to target
+// unless that is the same node
+numa_deque placed(int home, int target, size_t n) {
+    numa_deque c = filled_on(home, n);
+    if (target != home) {
+        numa::placement_scope scope(target);
+        c.reserve(c.capacity());
+    }
+    return c;
+}
+
+void read_benchmarks(runner &r, std::string const &placement, int home, int target, size_t n) {
+    numa_deque const c = placed(home, target, n);
+    r.run("numa_iterate", placement, n, [&c, n](sample_timer &t) {
+        value_type sum = 0;
+        t.start();
+        for (value_type v : c) {
+            sum += v;
+        }
+        t.stop();
+        do_not_optimize(sum);
+        return n;
+    });
+
+    r.run("numa_consume", placement, n, [home, target, n](sample_timer &t) {
+        numa_deque c = placed(home, target, n);
+        value_type sum = 0;
+        t.start();
+        while (!c.empty()) {
+            sum += c.front();
+            c.pop_front();
+        }
+        t.stop();
+        do_not_optimize(sum);
+        return n;
+    });
+}
+
+}
+
+int run_numa_suite(options const &opts) {
+    int nodes = numa::node_count();
+    int consumer = nodes - 1;
+    int remote = 0;
+    size_t n = opts.size;
+
+    if (!numa::run_on_node(consumer)) {
+        std::cerr << "note: could not pin to the CPUs of node " << consumer << '\n';
+    }
+    if (nodes == 1) {
+        std::cerr << "note: one NUMA node; remote and local placement are the same memory\n";
+    }
+
+    // The consumer always runs on its own node; what changes is where the
+    // buffer it reads lives. "remote" is a deque filled on another node,
+    // "migrated" the same deque after reserve() under a placement scope for
+    // the consumer's node moved it over.
+    runner r(opts);
+    r.run("numa_migrate", "remote->local", n, [remote, consumer, n](sample_timer &t) {
+        numa_deque c = filled_on(remote, n);
+        numa::placement_scope scope(consumer);
+        t.start();
+        c.reserve(c.capacity());
+        t.stop();
+        do_not_optimize(c);
+        return n;
+    });
+    read_benchmarks(r, "remote", remote, remote, n);
+    read_benchmarks(r, "local", consumer, consumer, n);
+    read_benchmarks(r, "migrated", remote, consumer, n);
+
+    if (opts.list_only) {
+        return 0;
+    }
+
+    numa_deque sample = placed(remote, consumer, n);
+    std::cout << "nodes: " << nodes << ", consumer on node " << consumer << ", migrated buffer on node "
+              << numa::node_of(&sample[0]) << ", placement failures " << numa::placement_failures() << '\n';
+    r.print_table(std::cout);
+    if (opts.json_path == "-") {
+        r.write_json(std::cout);
+    } else if (!opts.json_path.empty()) {
+        std::ofstream out(opts.json_path);
+        r.write_json(out);
+        if (!out) {
+            std::cerr << "failed to write " << opts.json_path << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}
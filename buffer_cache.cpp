@@ -0,0 +1,182 @@
+#include "buffer_cache.h"
+
+#include <mutex>
+#include <new>
+
+namespace {
+    size_t const min_class_log = 6;
+    size_t const max_class_log = 20;
+    size_t const class_count = max_class_log - min_class_log + 1;
+    size_t const local_blocks_per_class = 16;
+    size_t const global_blocks_per_class = 64;
+
+    static_assert(buffer_cache::min_class_bytes == size_t(1) << min_class_log, "class bounds");
+    static_assert(buffer_cache::max_cached_bytes == size_t(1) << max_class_log, "class bounds");
+
+    size_t class_of(size_t bytes) {
+        size_t log = min_class_log;
+        while ((size_t(1) << log) < bytes) {
+            log++;
+        }
+        return log - min_class_log;
+    }
+
+    size_t class_bytes(size_t cls) {
+        return size_t(1) << (cls + min_class_log);
+    }
+
+    // Trivially destructible, so it stays usable after the thread's
+    // flusher ran: deques destroyed later just bypass the local cache.
+    struct local_cache {
+        void *blocks[class_count][local_blocks_per_class];
+        size_t count[class_count];
+        size_t bytes;
+        bool dead;
+        buffer_cache_stats stats;
+    };
+
+    // Fixed arrays and no destructor: blocks may be returned to it by
+    // static destructors running at exit.
+    struct global_pool {
+        std::mutex lock;
+        void *blocks[class_count][global_blocks_per_class];
+        size_t count[class_count];
+        size_t bytes;
+    };
+
+    thread_local local_cache local;
+    global_pool global;
+
+    // returns false if the pool is full
+    bool give_to_global(void *ptr, size_t cls) {
+        size_t size = class_bytes(cls);
+        std::lock_guard<std::mutex> g(global.lock);
+        if (global.count[cls] == global_blocks_per_class || global.bytes + size > buffer_cache::max_global_bytes) {
+            return false;
+        }
+        global.blocks[cls][global.count[cls]++] = ptr;
+        global.bytes += size;
+        return true;
+    }
+
+    void *take_from_global(size_t cls) {
+        std::lock_guard<std::mutex> g(global.lock);
+        if (global.count[cls] == 0) {
+            return nullptr;
+        }
+        global.bytes -= class_bytes(cls);
+        return global.blocks[cls][--global.count[cls]];
+    }
+
+    void retire(void *ptr, size_t cls) {
+        if (!give_to_global(ptr, cls)) {
+            local.stats.evicted++;
+            operator delete(ptr);
+        }
+    }
+
+    void flush_local() {
+        for (size_t cls = 0; cls != class_count; ++cls) {
+            while (local.count[cls] != 0) {
+                retire(local.blocks[cls][--local.count[cls]], cls);
+            }
+        }
+        local.bytes = 0;
+        local.stats.retained_bytes = 0;
+    }
+
+    struct flusher {
+        ~flusher() {
+            flush_local();
+            local.dead = true;
+        }
+    };
+
+    thread_local flusher local_flusher;
+}
+
+namespace buffer_cache {
+
+void *allocate(size_t bytes) {
+    if (bytes > max_cached_bytes) {
+        return operator new(bytes);
+    }
+    size_t cls = class_of(bytes);
+
+    if (local.count[cls] != 0) {
+        local.stats.local_hits++;
+        local.bytes -= class_bytes(cls);
+        local.stats.retained_bytes = local.bytes;
+        return local.blocks[cls][--local.count[cls]];
+    }
+    if (void *ptr = take_from_global(cls)) {
+        local.stats.global_hits++;
+        return ptr;
+    }
+    local.stats.misses++;
+    return operator new(class_bytes(cls));
+}
+
+void deallocate(void *ptr, size_t bytes) noexcept {
+    if (bytes > max_cached_bytes) {
+        operator delete(ptr);
+        return;
+    }
+    size_t cls = class_of(bytes);
+    size_t size = class_bytes(cls);
+    local.stats.recycled++;
+
+    if (local.dead) {
+        retire(ptr, cls);
+        return;
+    }
+    // registers the flusher for this thread on its first use of the cache
+    (void) &local_flusher;
+
+    if (local.count[cls] == local_blocks_per_class || local.bytes + size > max_local_bytes) {
+        // make room by spilling half of the class, so a thread that frees
+        // what another allocates does not take the global lock every time
+        size_t keep = local.count[cls] / 2;
+        while (local.count[cls] > keep) {
+            local.bytes -= size;
+            retire(local.blocks[cls][--local.count[cls]], cls);
+        }
+        if (local.bytes + size > max_local_bytes) {
+            retire(ptr, cls);
+            local.stats.retained_bytes = local.bytes;
+            return;
+        }
+    }
+    local.blocks[cls][local.count[cls]++] = ptr;
+    local.bytes += size;
+    local.stats.retained_bytes = local.bytes;
+}
+
+buffer_cache_stats thread_stats() noexcept {
+    return local.stats;
+}
+
+size_t global_retained_bytes() noexcept {
+    std::lock_guard<std::mutex> g(global.lock);
+    return global.bytes;
+}
+
+void release_all() noexcept {
+    for (size_t cls = 0; cls != class_count; ++cls) {
+        while (local.count[cls] != 0) {
+            operator delete(local.blocks[cls][--local.count[cls]]);
+        }
+    }
+    local.bytes = 0;
+    local.stats.retained_bytes = 0;
+
+    std::lock_guard<std::mutex> g(global.lock);
+    for (size_t cls = 0; cls != class_count; ++cls) {
+        while (global.count[cls] != 0) {
+            operator delete(global.blocks[cls][--global.count[cls]]);
+        }
+    }
+    global.bytes = 0;
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+// Size-class cache of recently freed deque buffers. Every thread keeps a few
+// blocks per power-of-two class and spills to a bounded global pool that
+// other threads refill from, so short-lived deques and grow steps reuse warm
+// memory instead of going to the heap. Blocks of more than max_cached_bytes
+// bypass the cache. A hit never reaches operator new, so it is not a fault
+// injection point; misses and evictions go through operator new/delete.
+
+struct buffer_cache_stats {
+    size_t local_hits = 0;
+    size_t global_hits = 0;
+    size_t misses = 0;
+    // blocks given back to the cache, and those it freed because it was full
+    size_t recycled = 0;
+    size_t evicted = 0;
+    // bytes this thread's cache currently holds
+    size_t retained_bytes = 0;
+};
+
+namespace buffer_cache {
+
+size_t const min_class_bytes = 64;
+size_t const max_cached_bytes = size_t(1) << 20;
+size_t const max_local_bytes = size_t(4) << 20;
+size_t const max_global_bytes = size_t(64) << 20;
+
+// a block of at least bytes; the size passed to deallocate must be the same
+void *allocate(size_t bytes);
+void deallocate(void *ptr, size_t bytes) noexcept;
+
+// counters of the calling thread
+buffer_cache_stats thread_stats() noexcept;
+// bytes held by the global pool
+size_t global_retained_bytes() noexcept;
+
+// Frees everything the calling thread's cache and the global pool hold.
+void release_all() noexcept;
+
+}
+
+// my_deque storage policy that takes its buffers from buffer_cache.
+struct deque_recycling_storage {
+    static void *allocate(size_t bytes) {
+        return buffer_cache::allocate(bytes);
+    }
+
+    static void deallocate(void *ptr, size_t bytes) noexcept {
+        buffer_cache::deallocate(ptr, bytes);
+    }
+};
@@ -0,0 +1,394 @@
+#ifndef EXAM_DEQUE_COMPRESSED_DEQUE_H
+#define EXAM_DEQUE_COMPRESSED_DEQUE_H
+
+#include "my_deque.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+
+// A deque of unsigned integers for long, slowly changing sequences such as
+// IDs and timestamps. Whole blocks of block_size values are sealed: the
+// first value is kept as is and every other one as its difference to the
+// predecessor, minus the smallest such difference in the block, bit-packed
+// at the width of the largest. Timestamps a steady 1000 +- 100 apart take 8
+// bits each.
+// Only the two ends are plain rings. Each ring holds up to two blocks'
+// worth before its inner half is sealed, and a block is only unpacked when
+// its side runs empty, so alternating push and pop at a boundary does not
+// seal and unseal on every call.
+//
+// All packed words live in one my_deque<uint64_t>, in block order; a
+// block's words are addressed by an absolute word number, and words_base_
+// is the number of the pool's first word, so sealing at the front can
+// prepend words without moving the others.
+template<typename T = uint64_t>
+class compressed_deque {
+    static_assert(std::is_unsigned<T>::value, "compressed_deque holds unsigned integers");
+
+public:
+    static constexpr size_t block_size = 128;
+
+    class const_iterator;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    void push_back(T value);
+    void push_front(T value);
+    void pop_back();
+    void pop_front();
+    void clear() noexcept;
+
+    T front() const;
+    T back() const;
+    // unpacks up to block_size - 1 deltas of the block holding i
+    T operator[](size_t i) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // bytes held by all buffers, including unused capacity
+    size_t memory_bytes() const noexcept;
+    size_t sealed_blocks() const noexcept;
+
+private:
+    static constexpr unsigned value_bits = std::numeric_limits<T>::digits;
+
+    using signed_type = typename std::make_signed<T>::type;
+
+    struct block {
+        T first;
+        T last;
+        // smallest difference between neighbours, as a signed value
+        T min_delta;
+        size_t words_begin;
+        unsigned width;
+    };
+
+    static size_t words_for_(unsigned width) noexcept;
+
+    uint64_t word_(block const &b, size_t j) const noexcept;
+    T delta_(block const &b, size_t k) const noexcept;
+    T decode_(block const &b, size_t k) const noexcept;
+
+    // packs ring[from, from + block_size) into new words before or after
+    // all others; on failure the pool is left as it was
+    block seal_(my_deque<T> const &ring, size_t from, bool at_front);
+    // appends the values of b to the empty ring
+    void unseal_(block const &b, my_deque<T> &ring);
+
+    my_deque<T> front_;
+    my_deque<block> blocks_;
+    my_deque<uint64_t> words_;
+    size_t words_base_ = 0;
+    my_deque<T> back_;
+};
+
+template<typename T>
+class compressed_deque<T>::const_iterator {
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef ptrdiff_t difference_type;
+    typedef T const *pointer;
+    typedef T reference;
+
+    const_iterator() = default;
+
+    T operator*() const {
+        return value_;
+    }
+
+    // inside a block this adds one delta instead of unpacking from the start
+    const_iterator &operator++() {
+        ++index_;
+        size_t front = owner_->front_.size();
+        size_t sealed = owner_->blocks_.size() * block_size;
+        if (index_ >= front && index_ < front + sealed && (index_ - front) % block_size != 0) {
+            block const &b = owner_->blocks_[(index_ - front) / block_size];
+            value_ += owner_->delta_(b, (index_ - front) % block_size);
+        } else {
+            load_();
+        }
+        return *this;
+    }
+
+    const_iterator operator++(int) {
+        const_iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    friend bool operator==(const_iterator const &a, const_iterator const &b) {
+        return a.index_ == b.index_;
+    }
+
+    friend bool operator!=(const_iterator const &a, const_iterator const &b) {
+        return a.index_ != b.index_;
+    }
+
+private:
+    friend class compressed_deque;
+
+    const_iterator(compressed_deque const *owner, size_t index) : owner_(owner), index_(index) {
+        load_();
+    }
+
+    void load_() {
+        if (index_ < owner_->size()) {
+            value_ = (*owner_)[index_];
+        }
+    }
+
+    compressed_deque const *owner_ = nullptr;
+    size_t index_ = 0;
+    T value_ = 0;
+};
+
+template<typename T>
+size_t compressed_deque<T>::size() const noexcept {
+    return front_.size() + blocks_.size() * block_size + back_.size();
+}
+
+template<typename T>
+bool compressed_deque<T>::empty() const noexcept {
+    return size() == 0;
+}
+
+template<typename T>
+void compressed_deque<T>::push_back(T value) {
+    back_.push_back(value);
+    if (back_.size() < 2 * block_size) {
+        return;
+    }
+    size_t n = words_.size();
+    block b = seal_(back_, 0, false);
+    try {
+        blocks_.push_back(b);
+    } catch (...) {
+        words_.resize(n, 0);
+        throw;
+    }
+    for (size_t i = 0; i != block_size; ++i) {
+        back_.pop_front();
+    }
+}
+
+template<typename T>
+void compressed_deque<T>::push_front(T value) {
+    front_.push_front(value);
+    if (front_.size() < 2 * block_size) {
+        return;
+    }
+    blocks_.push_front(block());
+    block b;
+    try {
+        b = seal_(front_, block_size, true);
+    } catch (...) {
+        blocks_.pop_front();
+        throw;
+    }
+    blocks_.front() = b;
+    for (size_t i = 0; i != block_size; ++i) {
+        front_.pop_back();
+    }
+}
+
+template<typename T>
+void compressed_deque<T>::pop_front() {
+    if (front_.empty() && !blocks_.empty()) {
+        unseal_(blocks_.front(), front_);
+        size_t words = words_for_(blocks_.front().width);
+        for (size_t j = 0; j != words; ++j) {
+            words_.pop_front();
+        }
+        words_base_ += words;
+        blocks_.pop_front();
+    }
+    if (!front_.empty()) {
+        front_.pop_front();
+    } else {
+        back_.pop_front();
+    }
+}
+
+template<typename T>
+void compressed_deque<T>::pop_back() {
+    if (back_.empty() && !blocks_.empty()) {
+        unseal_(blocks_.back(), back_);
+        words_.resize(words_.size() - words_for_(blocks_.back().width), 0);
+        blocks_.pop_back();
+    }
+    if (!back_.empty()) {
+        back_.pop_back();
+    } else {
+        front_.pop_back();
+    }
+}
+
+template<typename T>
+void compressed_deque<T>::clear() noexcept {
+    front_.clear();
+    blocks_.clear();
+    words_.clear();
+    words_base_ = 0;
+    back_.clear();
+}
+
+template<typename T>
+T compressed_deque<T>::front() const {
+    if (!front_.empty()) {
+        return front_.front();
+    }
+    return blocks_.empty() ? back_.front() : blocks_.front().first;
+}
+
+template<typename T>
+T compressed_deque<T>::back() const {
+    if (!back_.empty()) {
+        return back_.back();
+    }
+    return blocks_.empty() ? front_.back() : blocks_.back().last;
+}
+
+template<typename T>
+T compressed_deque<T>::operator[](size_t i) const {
+    if (i < front_.size()) {
+        return front_[i];
+    }
+    i -= front_.size();
+    if (i < blocks_.size() * block_size) {
+        return decode_(blocks_[i / block_size], i % block_size);
+    }
+    return back_[i - blocks_.size() * block_size];
+}
+
+template<typename T>
+typename compressed_deque<T>::const_iterator compressed_deque<T>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template<typename T>
+typename compressed_deque<T>::const_iterator compressed_deque<T>::end() const {
+    return const_iterator(this, size());
+}
+
+template<typename T>
+size_t compressed_deque<T>::memory_bytes() const noexcept {
+    return (front_.capacity() + back_.capacity()) * sizeof(T) + blocks_.capacity() * sizeof(block) +
+           words_.capacity() * sizeof(uint64_t);
+}
+
+template<typename T>
+size_t compressed_deque<T>::sealed_blocks() const noexcept {
+    return blocks_.size();
+}
+
+template<typename T>
+size_t compressed_deque<T>::words_for_(unsigned width) noexcept {
+    return ((block_size - 1) * width + 63) / 64;
+}
+
+template<typename T>
+uint64_t compressed_deque<T>::word_(block const &b, size_t j) const noexcept {
+    return words_[b.words_begin - words_base_ + j];
+}
+
+template<typename T>
+T compressed_deque<T>::delta_(block const &b, size_t k) const noexcept {
+    if (b.width == 0) {
+        return b.min_delta;
+    }
+    size_t bit = (k - 1) * b.width;
+    size_t shift = bit % 64;
+    uint64_t bits = word_(b, bit / 64) >> shift;
+    if (shift + b.width > 64) {
+        bits |= word_(b, bit / 64 + 1) << (64 - shift);
+    }
+    if (b.width < 64) {
+        bits &= (uint64_t(1) << b.width) - 1;
+    }
+    return T(T(bits) + b.min_delta);
+}
+
+template<typename T>
+T compressed_deque<T>::decode_(block const &b, size_t k) const noexcept {
+    T value = b.first;
+    for (size_t i = 1; i <= k; ++i) {
+        value += delta_(b, i);
+    }
+    return value;
+}
+
+template<typename T>
+typename compressed_deque<T>::block compressed_deque<T>::seal_(my_deque<T> const &ring, size_t from, bool at_front) {
+    T min_delta = T(ring[from + 1] - ring[from]);
+    for (size_t i = 2; i != block_size; ++i) {
+        T delta = T(ring[from + i] - ring[from + i - 1]);
+        if (signed_type(delta) < signed_type(min_delta)) {
+            min_delta = delta;
+        }
+    }
+    // the offsets from min_delta are all non-negative as signed values, so
+    // their widest is the width of the largest one
+    T widest = 0;
+    for (size_t i = 1; i != block_size; ++i) {
+        widest |= T(ring[from + i] - ring[from + i - 1] - min_delta);
+    }
+    unsigned width = 0;
+    while (width < value_bits && (widest >> width) != 0) {
+        ++width;
+    }
+
+    size_t words = words_for_(width);
+    size_t at = 0;
+    if (at_front) {
+        size_t pushed = 0;
+        try {
+            for (; pushed != words; ++pushed) {
+                words_.push_front(0);
+            }
+        } catch (...) {
+            for (; pushed != 0; --pushed) {
+                words_.pop_front();
+            }
+            throw;
+        }
+        words_base_ -= words;
+    } else {
+        at = words_.size();
+        words_.resize(at + words, 0);
+    }
+
+    block b{ring[from], ring[from + block_size - 1], min_delta, words_base_ + at, width};
+    for (size_t i = 1; width != 0 && i != block_size; ++i) {
+        uint64_t z = T(ring[from + i] - ring[from + i - 1] - min_delta);
+        size_t bit = (i - 1) * width;
+        size_t shift = bit % 64;
+        words_[at + bit / 64] |= z << shift;
+        if (shift + width > 64) {
+            words_[at + bit / 64 + 1] |= z >> (64 - shift);
+        }
+    }
+    return b;
+}
+
+template<typename T>
+void compressed_deque<T>::unseal_(block const &b, my_deque<T> &ring) {
+    T value = b.first;
+    try {
+        ring.push_back(value);
+        for (size_t k = 1; k != block_size; ++k) {
+            value += delta_(b, k);
+            ring.push_back(value);
+        }
+    } catch (...) {
+        ring.clear();
+        throw;
+    }
+}
+
+#endif //EXAM_DEQUE_COMPRESSED_DEQUE_H
@@ -1,45 +1,234 @@
 #include "counted.h"
+#include "fault_injection.h"
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+    uint64_t hash_address(counted const *p) {
+        uint64_t h = reinterpret_cast<uintptr_t>(p);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Live instances created by one thread. Instances may be destroyed on
+    // another thread, so the counts are atomic and each instance remembers
+    // the ledger it was counted in.
+    struct ledger {
+        std::atomic<size_t> count;
+        std::atomic<uint64_t> checksum;
+    };
+
+    // Open-addressing set of addresses with linear probing and backward-shift
+    // deletion. Storage comes from calloc, so registering an instance neither
+    // goes through operator new (and its fault injection) nor allocates
+    // per insert.
+    struct shard {
+        struct slot {
+            counted const *p;
+            ledger *owner;
+        };
+
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        slot *slots = nullptr;
+        size_t capacity = 0;
+        size_t size = 0;
+
+        size_t find_slot(counted const *p, uint64_t h) const {
+            size_t i = h & (capacity - 1);
+            while (slots[i].p && slots[i].p != p) {
+                i = (i + 1) & (capacity - 1);
+            }
+            return i;
+        }
+
+        void grow() {
+            size_t new_capacity = capacity ? 2 * capacity : 64;
+            slot *old_slots = slots;
+            size_t old_capacity = capacity;
+            slots = static_cast<slot *>(std::calloc(new_capacity, sizeof(slot)));
+            if (!slots) {
+                std::abort();
+            }
+            capacity = new_capacity;
+            for (size_t i = 0; i != old_capacity; ++i) {
+                if (old_slots[i].p) {
+                    slots[find_slot(old_slots[i].p, hash_address(old_slots[i].p))] = old_slots[i];
+                }
+            }
+            std::free(old_slots);
+        }
+
+        bool insert(counted const *p, uint64_t h, ledger *owner) {
+            if (2 * (size + 1) > capacity) {
+                grow();
+            }
+            size_t i = find_slot(p, h);
+            if (slots[i].p) {
+                return false;
+            }
+            slots[i] = {p, owner};
+            size++;
+            return true;
+        }
+
+        bool contains(counted const *p, uint64_t h) const {
+            return capacity != 0 && slots[find_slot(p, h)].p == p;
+        }
+
+        // the ledger p was counted in, or nullptr if p is not in the set
+        ledger *erase(counted const *p, uint64_t h) {
+            if (capacity == 0) {
+                return nullptr;
+            }
+            size_t mask = capacity - 1;
+            size_t i = find_slot(p, h);
+            if (!slots[i].p) {
+                return nullptr;
+            }
+            ledger *owner = slots[i].owner;
+            // pull later entries of the probe run back into the hole, so
+            // lookups never need tombstones
+            for (size_t j = (i + 1) & mask; slots[j].p; j = (j + 1) & mask) {
+                size_t home = hash_address(slots[j].p) & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i] = {nullptr, nullptr};
+            size--;
+            return owner;
+        }
+    };
+
+    struct shard_lock {
+        explicit shard_lock(shard &s) : s(s) {
+            while (s.lock.test_and_set(std::memory_order_acquire)) {
+            }
+        }
+
+        ~shard_lock() {
+            s.lock.clear(std::memory_order_release);
+        }
+
+        shard &s;
+    };
+
+    constexpr size_t shard_count = 64;
+    shard shards[shard_count];
+
+    shard &shard_for(uint64_t h) {
+        return shards[h >> 58];
+    }
+
+    // The calling thread's ledger, made on first use. It comes from calloc
+    // like the shards and outlives the thread while instances it created are
+    // still alive, since their destructors will update it.
+    struct thread_ledger {
+        ledger *l = nullptr;
+
+        ~thread_ledger() {
+            if (l && l->count.load() == 0) {
+                l->~ledger();
+                std::free(l);
+            }
+        }
+
+        ledger &get() {
+            if (!l) {
+                void *p = std::calloc(1, sizeof(ledger));
+                if (!p) {
+                    std::abort();
+                }
+                l = new (p) ledger{{0}, {0}};
+            }
+            return *l;
+        }
+    };
+
+    thread_local thread_ledger this_thread_ledger;
+
+    bool register_instance(counted const *p) {
+        uint64_t h = hash_address(p);
+        ledger &owner = this_thread_ledger.get();
+        shard &s = shard_for(h);
+        shard_lock lock(s);
+        if (!s.insert(p, h, &owner)) {
+            return false;
+        }
+        owner.count.fetch_add(1, std::memory_order_relaxed);
+        owner.checksum.fetch_add(h, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool unregister_instance(counted const *p) {
+        uint64_t h = hash_address(p);
+        shard &s = shard_for(h);
+        shard_lock lock(s);
+        ledger *owner = s.erase(p, h);
+        if (!owner) {
+            return false;
+        }
+        owner->count.fetch_sub(1, std::memory_order_relaxed);
+        owner->checksum.fetch_sub(h, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool is_registered(counted const *p) {
+        uint64_t h = hash_address(p);
+        shard &s = shard_for(h);
+        shard_lock lock(s);
+        return s.contains(p, h);
+    }
+}
+
+// Registering an instance used to allocate a std::set node, which made every
+// construction a fault injection point; keep it one explicitly.
 counted::counted(int data)
         : data(data) {
-    auto p = instances.insert(this);
-    EXPECT_TRUE(p.second);
+    fault_injection_point();
+    EXPECT_TRUE(register_instance(this));
 }
 
 counted::counted(counted const &other)
         : data(other.data) {
-    auto p = instances.insert(this);
-    EXPECT_TRUE(p.second);
+    fault_injection_point();
+    EXPECT_TRUE(register_instance(this));
 }
 
 counted::~counted() {
-    size_t n = instances.erase(this);
-    EXPECT_EQ(1u, n);
+    EXPECT_TRUE(unregister_instance(this));
 }
 
 counted &counted::operator=(counted const &c) {
-    EXPECT_TRUE(instances.find(this) != instances.end());
+    EXPECT_TRUE(is_registered(this));
 
     data = c.data;
     return *this;
 }
 
 counted::operator int() const {
-    EXPECT_TRUE(instances.find(this) != instances.end());
+    EXPECT_TRUE(is_registered(this));
 
     return data;
 }
 
-std::set<counted const *> counted::instances;
-
 counted::no_new_instances_guard::no_new_instances_guard()
-        : old_instances(instances) {}
+        : old_count(this_thread_ledger.get().count.load()),
+          old_checksum(this_thread_ledger.get().checksum.load()) {}
 
 counted::no_new_instances_guard::~no_new_instances_guard() {
-    EXPECT_TRUE(old_instances == instances);
+    expect_no_instances();
 }
 
 void counted::no_new_instances_guard::expect_no_instances() {
-    EXPECT_TRUE(old_instances == instances);
+    ledger &own = this_thread_ledger.get();
+    EXPECT_EQ(old_count, own.count.load());
+    EXPECT_EQ(old_checksum, own.checksum.load());
 }
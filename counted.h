@@ -1,6 +1,7 @@
 #pragma once
 
-#include <set>
+#include <cstddef>
+#include <cstdint>
 
 struct counted {
     struct no_new_instances_guard;
@@ -15,10 +16,14 @@ struct counted {
 
 private:
     int data;
-
-    static std::set<counted const *> instances;
 };
 
+// Live instances are tracked in a sharded hash set that is safe to use from
+// several threads. The guard compares the number of live instances and an
+// order-independent checksum of their addresses, not the sets themselves.
+// Both are counted per creating thread, wherever the instance is destroyed:
+// a guard sees only instances made on its own thread, so other threads
+// creating counted objects meanwhile neither trip it nor hide a leak.
 struct counted::no_new_instances_guard {
     no_new_instances_guard();
 
@@ -30,5 +35,6 @@ struct counted::no_new_instances_guard {
     void expect_no_instances();
 
 private:
-    std::set<counted const *> old_instances;
+    size_t old_count;
+    uint64_t old_checksum;
 };
@@ -1,91 +1,130 @@
 #include "fault_injection.h"
+#include "alloc_profiler.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
 #include <vector>
 
-#include <sys/mman.h>
+#include <malloc.h>
 
 namespace
 {
-    template <typename T>
-    struct mmap_allocator
-    {
-        using value_type = T;
-
-        mmap_allocator() = default;
-        
-        T* allocate(size_t n)
-        {
-            void* ptr = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
-            if (ptr == MAP_FAILED)
-                throw std::bad_alloc();
-            return reinterpret_cast<T*>(ptr);
-        }
-        
-        void deallocate(void* p, std::size_t n)
-        {
-            int r = munmap(p, n);
-            if (r != 0)
-                std::abort();
-        }
-        
-    };
+    // Fixed-size, so the context never allocates: it is consulted from
+    // operator new and must not recurse into it or cost a syscall.
+    constexpr size_t max_faults_per_run = 256;
 
     struct fault_injection_context
     {
-        std::vector<size_t, mmap_allocator<size_t> > skip_ranges;
+        size_t skip_ranges[max_faults_per_run];
+        size_t skip_count = 0;
         size_t error_index = 0;
         size_t skip_index = 0;
         bool fault_registred = false;
+
+        void push_skip_range(size_t skip)
+        {
+            if (skip_count == max_faults_per_run)
+            {
+                std::fputs("fault injection: too many faults in one run\n", stderr);
+                std::abort();
+            }
+            skip_ranges[skip_count++] = skip;
+        }
     };
 
-    thread_local bool disabled = false;
-    thread_local fault_injection_context* context = nullptr;
+    // The context of the current faulty_run, or null when there is none or
+    // fault injection is disabled: the check every allocation pays for is
+    // this one thread-local load.
+    thread_local fault_injection_context* active = nullptr;
 
-    void dump_state()
+    std::atomic<bool> tracking_enabled(false);
+    // signed: blocks allocated before tracking was enabled may be freed later
+    std::atomic<std::ptrdiff_t> live_bytes(0);
+    std::atomic<std::ptrdiff_t> peak_bytes(0);
+    std::atomic<size_t> allocation_count(0);
+    std::atomic<size_t> deallocation_count(0);
+
+    void track_allocation(void* ptr)
     {
-#if 0
-        std::cout << "skip_ranges: {";
-        if (!context->skip_ranges.empty())
+        if (!tracking_enabled.load(std::memory_order_relaxed))
+            return;
+
+        std::ptrdiff_t size = malloc_usable_size(ptr);
+        std::ptrdiff_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        std::ptrdiff_t peak = peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
         {
-            std::cout << context->skip_ranges[0];
-            for (size_t i = 1; i != context->skip_ranges.size(); ++i)
-                std::cout << ", " << context->skip_ranges[i];
         }
-        std::cout << "}\nerror_index: " << context->error_index << "\nskip_index: " << context->skip_index << '\n' << std::flush;
-#endif
     }
-}
 
-bool should_inject_fault()
-{
-    if (!context)
-        return false;
+    void track_deallocation(void* ptr)
+    {
+        if (!ptr || !tracking_enabled.load(std::memory_order_relaxed))
+            return;
 
-    if (disabled)
-        return false;
+        live_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+        deallocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    assert(context->error_index <= context->skip_ranges.size());
-    if (context->error_index == context->skip_ranges.size())
+    void* checked_malloc(std::size_t count)
     {
-        ++context->error_index;
-        context->skip_ranges.push_back(0);
-        context->fault_registred = true;
-        return true;
+        if (should_inject_fault())
+            throw std::bad_alloc();
+
+        void* ptr = malloc(count);
+        if (!ptr)
+            throw std::bad_alloc();
+
+        track_allocation(ptr);
+        return ptr;
     }
 
-    assert(context->skip_index <= context->skip_ranges[context->error_index]);
+    void checked_free(void* ptr)
+    {
+        track_deallocation(ptr);
+        free(ptr);
+    }
+}
 
-    if (context->skip_index == context->skip_ranges[context->error_index])
+namespace
+{
+    __attribute__((noinline)) bool should_inject_fault_slow(fault_injection_context& ctx)
     {
-        ++context->error_index;
-        context->skip_index = 0;
-        context->fault_registred = true;
-        return true;
+        assert(ctx.error_index <= ctx.skip_count);
+        if (ctx.error_index == ctx.skip_count)
+        {
+            ++ctx.error_index;
+            ctx.push_skip_range(0);
+            ctx.fault_registred = true;
+            return true;
+        }
+
+        assert(ctx.skip_index <= ctx.skip_ranges[ctx.error_index]);
+
+        if (ctx.skip_index == ctx.skip_ranges[ctx.error_index])
+        {
+            ++ctx.error_index;
+            ctx.skip_index = 0;
+            ctx.fault_registred = true;
+            return true;
+        }
+
+        ++ctx.skip_index;
+        return false;
     }
+}
 
-    ++context->skip_index;
-    return false;
+bool should_inject_fault()
+{
+    fault_injection_context* ctx = active;
+    if (__builtin_expect(!ctx, 1))
+        return false;
+
+    return should_inject_fault_slow(*ctx);
 }
 
 void fault_injection_point()
@@ -94,86 +133,134 @@ void fault_injection_point()
         throw injected_fault("injected fault");
 }
 
-void faulty_run(std::function<void ()> const& f)
+namespace
 {
-    assert(!context);
-    fault_injection_context ctx;
-    context = &ctx;
-    for (;;)
+    // Runs f once per fault injection sequence whose first fault is at an
+    // allocation point p with p % stride == first. The first coordinate of
+    // skip_ranges is what partitions the search space: every sequence
+    // below it is explored depth-first, as in the serial driver.
+    void explore(std::function<void ()> const& f, size_t first, size_t stride)
     {
-        try
+        assert(!active);
+        fault_injection_context ctx;
+        ctx.push_skip_range(first);
+        active = &ctx;
+        for (;;)
         {
-            f();
+            try
+            {
+                f();
+            }
+            catch (...)
+            {
+                fault_injection_disable dg;
+                ctx.skip_count = ctx.error_index;
+                ctx.skip_ranges[ctx.skip_count - 1] += ctx.skip_count == 1 ? stride : 1;
+                ctx.error_index = 0;
+                ctx.skip_index = 0;
+                assert(ctx.fault_registred);
+                ctx.fault_registred = false;
+                continue;
+            }
+            assert(!ctx.fault_registred);
+            break;
         }
-        catch (...)
-        {
-            fault_injection_disable dg;
-            dump_state();
-            ctx.skip_ranges.resize(ctx.error_index);
-            ++ctx.skip_ranges.back();
-            ctx.error_index = 0;
-            ctx.skip_index = 0;
-            assert(ctx.fault_registred);
-            ctx.fault_registred = false;
-            continue;
-        }
-        assert(!ctx.fault_registred);
-        break;
+        active = nullptr;
     }
-    context = nullptr;
+}
+
+void faulty_run(std::function<void ()> const& f)
+{
+    explore(f, 0, 1);
+}
+
+void faulty_run_parallel(std::function<void ()> const& f, unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back(explore, std::cref(f), i, threads);
+    explore(f, 0, threads);
+    for (std::thread& t : workers)
+        t.join();
 }
 
 fault_injection_disable::fault_injection_disable()
-    : was_disabled(disabled)
+    : saved_context(active)
 {
-    disabled = true;
+    active = nullptr;
 }
 
 fault_injection_disable::~fault_injection_disable()
 {
-    disabled = was_disabled;
+    active = static_cast<fault_injection_context*>(saved_context);
 }
 
-void* operator new(std::size_t count)
+void enable_allocation_tracking(bool enable)
 {
-    if (should_inject_fault())
-        throw std::bad_alloc();
+    if (enable && !tracking_enabled.load())
+    {
+        live_bytes = 0;
+        peak_bytes = 0;
+        allocation_count = 0;
+        deallocation_count = 0;
+    }
+    tracking_enabled = enable;
+}
 
-    void* ptr = malloc(count);
-    if (!ptr)
-        throw std::bad_alloc();
+allocation_stats get_allocation_stats()
+{
+    allocation_stats res;
+    res.live_bytes = std::max<std::ptrdiff_t>(0, live_bytes.load(std::memory_order_relaxed));
+    res.peak_bytes = std::max<std::ptrdiff_t>(0, peak_bytes.load(std::memory_order_relaxed));
+    res.allocations = allocation_count.load(std::memory_order_relaxed);
+    res.deallocations = deallocation_count.load(std::memory_order_relaxed);
+    return res;
+}
 
+void reset_peak_allocation()
+{
+    peak_bytes = live_bytes.load();
+}
+
+void* operator new(std::size_t count)
+{
+    void* ptr = checked_malloc(count);
+    // recorded here rather than in checked_malloc, so operator new stays on
+    // the stack and the profiler can tell where the caller's frames begin
+    if (allocation_profiling_enabled())
+        record_allocation_site(count);
     return ptr;
 }
 
 void* operator new[](std::size_t count)
 {
-    if (should_inject_fault())
-        throw std::bad_alloc();
-
-    void* ptr = malloc(count);
-    if (!ptr)
-        throw std::bad_alloc();
-
+    void* ptr = checked_malloc(count);
+    // recorded here rather than in checked_malloc, so operator new stays on
+    // the stack and the profiler can tell where the caller's frames begin
+    if (allocation_profiling_enabled())
+        record_allocation_site(count);
     return ptr;
 }
 
 void operator delete(void* ptr) noexcept
 {
-    free(ptr);
+    checked_free(ptr);
 }
 
 void operator delete[](void* ptr) noexcept
 {
-    free(ptr);
+    checked_free(ptr);
 }
 
 void operator delete(void* ptr, std::size_t) noexcept
 {
-    free(ptr);
+    checked_free(ptr);
 }
 
 void operator delete[](void* ptr, std::size_t) noexcept
 {
-    free(ptr);
+    checked_free(ptr);
 }
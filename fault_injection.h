@@ -8,10 +8,31 @@ struct injected_fault : std::runtime_error
     using runtime_error::runtime_error;
 };
 
+struct allocation_stats
+{
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t allocations;
+    size_t deallocations;
+};
+
+// Byte accounting done by the global operator new/delete replacements.
+// It is off by default; sizes are malloc_usable_size, so they include
+// allocator rounding but not malloc's own headers.
+void enable_allocation_tracking(bool enable);
+allocation_stats get_allocation_stats();
+void reset_peak_allocation();
+
 bool should_inject_fault();
 void fault_injection_point();
 void faulty_run(std::function<void ()> const& f);
 
+// Same exploration as faulty_run, split across worker threads by the
+// position of the first injected fault. Each worker has its own context,
+// so f is run concurrently and must only touch thread-safe state.
+// threads == 0 means std::thread::hardware_concurrency().
+void faulty_run_parallel(std::function<void ()> const& f, unsigned threads = 0);
+
 struct fault_injection_disable
 {
     fault_injection_disable();
@@ -20,5 +41,5 @@ struct fault_injection_disable
     ~fault_injection_disable();
 
 private:
-    bool was_disabled;
+    void* saved_context;
 };
@@ -0,0 +1,487 @@
+#ifndef EXAM_DEQUE_INCREMENTAL_DEQUE_H
+#define EXAM_DEQUE_INCREMENTAL_DEQUE_H
+
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// A ring deque that never relocates everything at once. When the ring is
+// full it allocates a buffer twice as large and then moves at most
+// migrate_per_op elements from the old buffer on every following push (and
+// pop, for nothrow-movable types), the way incremental rehashing works, so no
+// single operation is O(n). The ring cannot fill up again before the
+// migration is over, since every push moves at least one element.
+//
+// Elements are addressed by an absolute position that only changes by
+// push_front/pop_front; the slot of position p is p & (capacity - 1) in
+// whichever buffer holds it. Growth keeps every position, so an element that
+// has not been migrated yet is still found at its old slot: positions in
+// [old_begin_, old_end_) live in the old buffer, everything else in the new.
+template<typename T>
+class incremental_deque {
+
+    template<typename V>
+    struct index_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef V value_type;
+        typedef ptrdiff_t difference_type;
+        typedef V *pointer;
+        typedef V &reference;
+
+        friend class incremental_deque;
+
+        using owner_pointer = typename std::conditional<std::is_const<V>::value,
+                                                        incremental_deque const *,
+                                                        incremental_deque *>::type;
+
+    private:
+        index_iterator(owner_pointer owner, size_t index) : owner_(owner), index_(index) {}
+
+    public:
+        index_iterator() : owner_(nullptr), index_(0) {}
+
+        template<typename U>
+        index_iterator(index_iterator<U> const &other,
+                       typename std::enable_if<std::is_same<U const, V>::value &&
+                                               std::is_const<V>::value>::type * = nullptr)
+                : owner_(other.owner_), index_(other.index_) {}
+
+        reference operator*() const {
+            return (*owner_)[index_];
+        }
+
+        pointer operator->() const {
+            return &(*owner_)[index_];
+        }
+
+        reference operator[](difference_type diff) const {
+            return (*owner_)[index_ + diff];
+        }
+
+        index_iterator &operator++() {
+            ++index_;
+            return *this;
+        }
+
+        index_iterator operator++(int) {
+            auto res = *this;
+            ++index_;
+            return res;
+        }
+
+        index_iterator &operator--() {
+            --index_;
+            return *this;
+        }
+
+        index_iterator operator--(int) {
+            auto res = *this;
+            --index_;
+            return res;
+        }
+
+        index_iterator &operator+=(difference_type diff) {
+            index_ += diff;
+            return *this;
+        }
+
+        index_iterator &operator-=(difference_type diff) {
+            index_ -= diff;
+            return *this;
+        }
+
+        friend index_iterator operator+(index_iterator it, difference_type diff) {
+            return it += diff;
+        }
+
+        friend index_iterator operator-(index_iterator it, difference_type diff) {
+            return it -= diff;
+        }
+
+        friend difference_type operator-(index_iterator const &a, index_iterator const &b) {
+            return difference_type(a.index_ - b.index_);
+        }
+
+        friend bool operator==(index_iterator const &a, index_iterator const &b) {
+            return a.index_ == b.index_ && a.owner_ == b.owner_;
+        }
+
+        friend bool operator!=(index_iterator const &a, index_iterator const &b) {
+            return !(a == b);
+        }
+
+        friend bool operator<(index_iterator const &a, index_iterator const &b) {
+            return a.index_ < b.index_;
+        }
+
+        friend bool operator<=(index_iterator const &a, index_iterator const &b) {
+            return a.index_ <= b.index_;
+        }
+
+        friend bool operator>(index_iterator const &a, index_iterator const &b) {
+            return a.index_ > b.index_;
+        }
+
+        friend bool operator>=(index_iterator const &a, index_iterator const &b) {
+            return a.index_ >= b.index_;
+        }
+
+    private:
+        owner_pointer owner_;
+        size_t index_;
+    };
+
+public:
+    using iterator = index_iterator<T>;
+    using const_iterator = index_iterator<T const>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_t migrate_per_op = 2;
+
+    incremental_deque() noexcept;
+    incremental_deque(incremental_deque const &other);
+    incremental_deque &operator=(incremental_deque const &other);
+    ~incremental_deque();
+
+    void push_back(T const &value);
+    void push_front(T const &value);
+    void pop_back();
+    void pop_front();
+
+    T &back() noexcept;
+    T const &back() const noexcept;
+
+    T &front() noexcept;
+    T const &front() const noexcept;
+
+    T &operator[](size_t index) noexcept;
+    T const &operator[](size_t index) const noexcept;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+    size_t capacity() const noexcept;
+    bool migrating() const noexcept;
+    void clear() noexcept;
+
+    // completes a pending migration now, e.g. before a latency-critical section
+    void finish_migration();
+
+    iterator begin();
+    iterator end();
+    reverse_iterator rbegin();
+    reverse_iterator rend();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator rend() const;
+
+    template<typename T1>
+    friend void swap(incremental_deque<T1> &a, incremental_deque<T1> &b) noexcept;
+
+private:
+    static constexpr size_t min_capacity = 8;
+
+    bool in_old_(size_t pos) const noexcept {
+        return pos - old_begin_ < old_end_ - old_begin_;
+    }
+
+    T *slot_(size_t pos) const noexcept {
+        return in_old_(pos) ? old_data_ + (pos & (old_capacity_ - 1)) : data_ + (pos & (capacity_ - 1));
+    }
+
+    void destroy_at_(size_t pos) noexcept {
+        slot_(pos)->~T();
+        if (pos == old_begin_ && old_begin_ != old_end_) {
+            old_begin_++;
+        } else if (pos + 1 == old_end_ && old_begin_ != old_end_) {
+            old_end_--;
+        }
+        release_old_if_done_();
+    }
+
+    // Moves one element from the back of the old range into the new buffer.
+    void migrate_one_() {
+        size_t pos = old_end_ - 1;
+        T *from = old_data_ + (pos & (old_capacity_ - 1));
+        new(data_ + (pos & (capacity_ - 1))) T(std::move_if_noexcept(*from));
+        from->~T();
+        old_end_--;
+    }
+
+    void release_old_if_done_() noexcept {
+        if (old_data_ != nullptr && old_begin_ == old_end_) {
+            operator delete(old_data_);
+            old_data_ = nullptr;
+            old_capacity_ = 0;
+        }
+    }
+
+    // Bounded work done by every push, before it touches anything else: a
+    // throwing copy leaves the element where it was and the push fails with
+    // the deque unchanged. Pops only help when moving cannot throw.
+    void migrate_step_() {
+        for (size_t i = 0; i != migrate_per_op && old_begin_ != old_end_; ++i) {
+            migrate_one_();
+        }
+        release_old_if_done_();
+    }
+
+    void migrate_step_nothrow_() noexcept {
+        if (std::is_nothrow_move_constructible<T>::value) {
+            for (size_t i = 0; i != migrate_per_op && old_begin_ != old_end_; ++i) {
+                migrate_one_();
+            }
+            release_old_if_done_();
+        }
+    }
+
+    size_t grown_capacity_() const noexcept {
+        return capacity_ ? 2 * capacity_ : min_capacity;
+    }
+
+    // Constructs the element at pos, first switching to a larger buffer if the
+    // ring is full. Nothing changes if the allocation or the copy throws.
+    void construct_at_(size_t pos, T const &value) {
+        if (size_ < capacity_) {
+            new(data_ + (pos & (capacity_ - 1))) T(value);
+            return;
+        }
+        finish_migration();
+        size_t new_capacity = grown_capacity_();
+        T *new_data = static_cast<T *>(operator new(new_capacity * sizeof(T)));
+        try {
+            new(new_data + (pos & (new_capacity - 1))) T(value);
+        } catch (...) {
+            operator delete(new_data);
+            throw;
+        }
+        adopt_(new_data);
+    }
+
+    void adopt_(T *new_data) noexcept {
+        if (size_ == 0) {
+            operator delete(data_);
+        } else {
+            old_data_ = data_;
+            old_capacity_ = capacity_;
+            old_begin_ = head_;
+            old_end_ = head_ + size_;
+        }
+        data_ = new_data;
+        capacity_ = grown_capacity_();
+    }
+
+    T *data_;
+    size_t capacity_;
+    size_t head_;
+    size_t size_;
+
+    T *old_data_;
+    size_t old_capacity_;
+    size_t old_begin_;
+    size_t old_end_;
+};
+
+template<typename T>
+incremental_deque<T>::incremental_deque() noexcept
+        : data_(nullptr),
+          capacity_(0),
+          head_(0),
+          size_(0),
+          old_data_(nullptr),
+          old_capacity_(0),
+          old_begin_(0),
+          old_end_(0) {}
+
+template<typename T>
+incremental_deque<T>::incremental_deque(incremental_deque const &other) : incremental_deque() {
+    if (other.size_ == 0) {
+        return;
+    }
+    size_t capacity = min_capacity;
+    while (capacity < other.size_) {
+        capacity *= 2;
+    }
+    data_ = static_cast<T *>(operator new(capacity * sizeof(T)));
+    capacity_ = capacity;
+    try {
+        for (; size_ != other.size_; ++size_) {
+            new(data_ + size_) T(other[size_]);
+        }
+    } catch (...) {
+        clear();
+        operator delete(data_);
+        throw;
+    }
+}
+
+template<typename T>
+incremental_deque<T> &incremental_deque<T>::operator=(incremental_deque const &other) {
+    incremental_deque tmp(other);
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename T>
+incremental_deque<T>::~incremental_deque() {
+    clear();
+    operator delete(data_);
+}
+
+template<typename T>
+void incremental_deque<T>::push_back(T const &value) {
+    migrate_step_();
+    construct_at_(head_ + size_, value);
+    size_++;
+}
+
+template<typename T>
+void incremental_deque<T>::push_front(T const &value) {
+    migrate_step_();
+    construct_at_(head_ - 1, value);
+    head_--;
+    size_++;
+}
+
+template<typename T>
+void incremental_deque<T>::pop_back() {
+    destroy_at_(head_ + size_ - 1);
+    size_--;
+    migrate_step_nothrow_();
+}
+
+template<typename T>
+void incremental_deque<T>::pop_front() {
+    destroy_at_(head_);
+    head_++;
+    size_--;
+    migrate_step_nothrow_();
+}
+
+template<typename T>
+T &incremental_deque<T>::back() noexcept {
+    return *slot_(head_ + size_ - 1);
+}
+
+template<typename T>
+T const &incremental_deque<T>::back() const noexcept {
+    return *slot_(head_ + size_ - 1);
+}
+
+template<typename T>
+T &incremental_deque<T>::front() noexcept {
+    return *slot_(head_);
+}
+
+template<typename T>
+T const &incremental_deque<T>::front() const noexcept {
+    return *slot_(head_);
+}
+
+template<typename T>
+T &incremental_deque<T>::operator[](size_t index) noexcept {
+    return *slot_(head_ + index);
+}
+
+template<typename T>
+T const &incremental_deque<T>::operator[](size_t index) const noexcept {
+    return *slot_(head_ + index);
+}
+
+template<typename T>
+bool incremental_deque<T>::empty() const noexcept {
+    return size_ == 0;
+}
+
+template<typename T>
+size_t incremental_deque<T>::size() const noexcept {
+    return size_;
+}
+
+template<typename T>
+size_t incremental_deque<T>::capacity() const noexcept {
+    return capacity_;
+}
+
+template<typename T>
+bool incremental_deque<T>::migrating() const noexcept {
+    return old_data_ != nullptr;
+}
+
+template<typename T>
+void incremental_deque<T>::clear() noexcept {
+    while (size_ != 0) {
+        destroy_at_(head_ + size_ - 1);
+        size_--;
+    }
+    head_ = 0;
+}
+
+template<typename T>
+void incremental_deque<T>::finish_migration() {
+    while (old_begin_ != old_end_) {
+        migrate_one_();
+    }
+    release_old_if_done_();
+}
+
+template<typename T>
+typename incremental_deque<T>::iterator incremental_deque<T>::begin() {
+    return iterator(this, 0);
+}
+
+template<typename T>
+typename incremental_deque<T>::iterator incremental_deque<T>::end() {
+    return iterator(this, size_);
+}
+
+template<typename T>
+typename incremental_deque<T>::reverse_iterator incremental_deque<T>::rbegin() {
+    return reverse_iterator(end());
+}
+
+template<typename T>
+typename incremental_deque<T>::reverse_iterator incremental_deque<T>::rend() {
+    return reverse_iterator(begin());
+}
+
+template<typename T>
+typename incremental_deque<T>::const_iterator incremental_deque<T>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template<typename T>
+typename incremental_deque<T>::const_iterator incremental_deque<T>::end() const {
+    return const_iterator(this, size_);
+}
+
+template<typename T>
+typename incremental_deque<T>::const_reverse_iterator incremental_deque<T>::rbegin() const {
+    return const_reverse_iterator(end());
+}
+
+template<typename T>
+typename incremental_deque<T>::const_reverse_iterator incremental_deque<T>::rend() const {
+    return const_reverse_iterator(begin());
+}
+
+template<typename T>
+void swap(incremental_deque<T> &a, incremental_deque<T> &b) noexcept {
+    std::swap(a.data_, b.data_);
+    std::swap(a.capacity_, b.capacity_);
+    std::swap(a.head_, b.head_);
+    std::swap(a.size_, b.size_);
+    std::swap(a.old_data_, b.old_data_);
+    std::swap(a.old_capacity_, b.old_capacity_);
+    std::swap(a.old_begin_, b.old_begin_);
+    std::swap(a.old_end_, b.old_end_);
+}
+
+
+#endif //EXAM_DEQUE_INCREMENTAL_DEQUE_H
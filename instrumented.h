@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+
+struct op_counts {
+    size_t constructions = 0;
+    size_t copies = 0;
+    size_t moves = 0;
+    size_t copy_assignments = 0;
+    size_t move_assignments = 0;
+    size_t destructions = 0;
+
+    size_t all_copies() const {
+        return copies + copy_assignments;
+    }
+
+    size_t all_moves() const {
+        return moves + move_assignments;
+    }
+};
+
+// Element type that counts every special member call made on it, so tests
+// can bound how much work a container operation does, not only check its
+// result. NothrowMove selects whether the move constructor is noexcept,
+// which decides between moving and copying on reallocation.
+template<bool NothrowMove>
+struct basic_instrumented {
+    static op_counts counts;
+
+    static void reset_counts() {
+        counts = op_counts();
+    }
+
+    basic_instrumented(int data = 0) : data(data) {
+        counts.constructions++;
+    }
+
+    basic_instrumented(basic_instrumented const &other) : data(other.data) {
+        counts.copies++;
+    }
+
+    basic_instrumented(basic_instrumented &&other) noexcept(NothrowMove) : data(other.data) {
+        counts.moves++;
+    }
+
+    basic_instrumented &operator=(basic_instrumented const &other) {
+        data = other.data;
+        counts.copy_assignments++;
+        return *this;
+    }
+
+    basic_instrumented &operator=(basic_instrumented &&other) noexcept(NothrowMove) {
+        data = other.data;
+        counts.move_assignments++;
+        return *this;
+    }
+
+    ~basic_instrumented() {
+        counts.destructions++;
+    }
+
+    operator int() const {
+        return data;
+    }
+
+private:
+    int data;
+};
+
+template<bool NothrowMove>
+op_counts basic_instrumented<NothrowMove>::counts;
+
+using instrumented = basic_instrumented<true>;
+using instrumented_throwing_move = basic_instrumented<false>;
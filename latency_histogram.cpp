@@ -0,0 +1,94 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+
+latency_histogram::latency_histogram()
+        : counts_(index_of(~uint64_t(0)) + 1, 0) {}
+
+void latency_histogram::merge(latency_histogram const &other) {
+    for (size_t i = 0; i != counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    sum_ += other.sum_;
+    if (other.max_ > max_) {
+        max_ = other.max_;
+    }
+}
+
+void latency_histogram::clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    max_ = 0;
+    sum_ = 0;
+}
+
+double latency_histogram::mean() const {
+    return total_ == 0 ? 0 : sum_ / total_;
+}
+
+uint64_t latency_histogram::highest_value_of(size_t index) {
+    if (index < sub_bucket_count) {
+        return index;
+    }
+    size_t shift = (index - sub_bucket_count) / sub_bucket_half + 1;
+    uint64_t sub = (index - sub_bucket_count) % sub_bucket_half + sub_bucket_half;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t latency_histogram::percentile(double q) const {
+    if (total_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * total_ + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i != counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            uint64_t v = highest_value_of(i);
+            return v < max_ ? v : max_;
+        }
+    }
+    return max_;
+}
+
+uint64_t latency_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double ticks_per_ns() {
+    static double const value = [] {
+#if defined(__x86_64__) || defined(__i386__)
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tick_start = latency_ticks();
+        while (std::chrono::steady_clock::now() - wall_start < std::chrono::milliseconds(20)) {
+        }
+        uint64_t tick_end = latency_ticks();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start).count();
+        return ns > 0 ? (tick_end - tick_start) / ns : 1.0;
+#else
+        return 1.0;
+#endif
+    }();
+    return value;
+}
+
+}
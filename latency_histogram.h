@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+// Log-linear histogram in the style of HdrHistogram: every power-of-two
+// range is split into the same number of linear sub-buckets, so the relative
+// error of a recorded value is bounded (below 1/32 with 6 significant bits)
+// from a single tick up to 2^64.
+class latency_histogram {
+public:
+    static constexpr unsigned sub_bucket_bits = 6;
+
+    latency_histogram();
+
+    void record(uint64_t value) {
+        counts_[index_of(value)]++;
+        total_++;
+        sum_ += value;
+        if (value > max_) {
+            max_ = value;
+        }
+    }
+
+    void merge(latency_histogram const &other);
+    void clear();
+
+    uint64_t count() const {
+        return total_;
+    }
+
+    uint64_t max() const {
+        return max_;
+    }
+
+    double mean() const;
+
+    // smallest recorded bucket value v such that at least q * count() values are <= v
+    uint64_t percentile(double q) const;
+
+private:
+    static constexpr uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+    static constexpr uint64_t sub_bucket_half = sub_bucket_count / 2;
+
+    static size_t index_of(uint64_t value) {
+        if (value < sub_bucket_count) {
+            return static_cast<size_t>(value);
+        }
+        unsigned shift = 64 - __builtin_clzll(value) - sub_bucket_bits;
+        return static_cast<size_t>(sub_bucket_count + (shift - 1) * sub_bucket_half +
+                                   ((value >> shift) - sub_bucket_half));
+    }
+
+    static uint64_t highest_value_of(size_t index);
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+    double sum_ = 0;
+};
+
+// Cheapest available timestamp: the TSC on x86, steady_clock elsewhere.
+// ticks_per_ns() is calibrated once against steady_clock.
+uint64_t latency_ticks();
+double ticks_per_ns();
+
+}
@@ -0,0 +1,110 @@
+#include "memory_budget.h"
+
+#include <cassert>
+
+memory_registry::memory_registry(size_t budget) noexcept
+        : budget_(budget) {}
+
+memory_registry::~memory_registry() {
+    assert(member_count_ == 0);
+    for (deque_memory_member *m = first_; m; m = m->next_) {
+        m->registry_ = nullptr;
+    }
+}
+
+size_t memory_registry::total_bytes() const noexcept {
+    return total_bytes_;
+}
+
+size_t memory_registry::budget() const noexcept {
+    return budget_;
+}
+
+void memory_registry::set_budget(size_t budget) noexcept {
+    budget_ = budget;
+}
+
+void memory_registry::set_over_budget_handler(over_budget_handler handler) {
+    handler_ = std::move(handler);
+}
+
+size_t memory_registry::member_count() const noexcept {
+    return member_count_;
+}
+
+size_t memory_registry::trim_idle() noexcept {
+    size_t released = 0;
+    for (deque_memory_member *m = first_; m; m = m->next_) {
+        if (m->last_used_ >= generation_) {
+            continue;
+        }
+        size_t before = m->held_bytes_;
+        try {
+            m->trim_(*m);
+        } catch (...) {
+            // trimming needs a smaller buffer first; without one, keep the old
+        }
+        released += before - m->held_bytes_;
+    }
+    generation_++;
+    return released;
+}
+
+void memory_registry::charge(size_t old_bytes, size_t new_bytes) {
+    for (;;) {
+        size_t needed = total_bytes_ - old_bytes + new_bytes;
+        if (needed <= budget_) {
+            return;
+        }
+        if (!handler_ || !handler_(*this, needed - budget_)) {
+            throw memory_budget_exceeded();
+        }
+    }
+}
+
+deque_memory_member::~deque_memory_member() {
+    leave();
+}
+
+void deque_memory_member::join(memory_registry &registry, trim_function trim, bool charge) {
+    assert(!registry_);
+    if (charge) {
+        registry.charge(0, held_bytes_);
+    }
+    registry_ = &registry;
+    trim_ = trim;
+    last_used_ = registry.generation_;
+
+    next_ = registry.first_;
+    if (next_) {
+        next_->prev_ = this;
+    }
+    registry.first_ = this;
+    registry.member_count_++;
+    registry.total_bytes_ += held_bytes_;
+}
+
+void deque_memory_member::leave() noexcept {
+    if (!registry_) {
+        return;
+    }
+    registry_->total_bytes_ -= held_bytes_;
+    registry_->member_count_--;
+    if (prev_) {
+        prev_->next_ = next_;
+    } else {
+        registry_->first_ = next_;
+    }
+    if (next_) {
+        next_->prev_ = prev_;
+    }
+    prev_ = next_ = nullptr;
+    registry_ = nullptr;
+}
+
+void deque_memory_member::set_held(size_t held) noexcept {
+    if (registry_) {
+        registry_->total_bytes_ += held - held_bytes_;
+    }
+    held_bytes_ = held;
+}
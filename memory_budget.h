@@ -0,0 +1,230 @@
+#ifndef EXAM_DEQUE_MEMORY_BUDGET_H
+#define EXAM_DEQUE_MEMORY_BUDGET_H
+
+#include "my_deque.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+struct memory_budget_exceeded : std::bad_alloc {
+    char const *what() const noexcept override {
+        return "memory budget exceeded";
+    }
+};
+
+class deque_memory_member;
+
+// Accounts the buffers of the deques that joined it against a budget and
+// can give back the slack of those that sit idle. Neither the registry nor
+// its members are synchronized: a registry belongs to one thread, or all
+// use of it and of its deques has to be serialized by the caller.
+class memory_registry {
+public:
+    // Called when a reallocation would take the total over the budget, with
+    // the number of bytes that are missing. It may release memory, e.g. with
+    // trim_idle(), and returns whether to check again; once it returns false
+    // the reallocation fails with memory_budget_exceeded.
+    using over_budget_handler = std::function<bool(memory_registry &, size_t missing)>;
+
+    explicit memory_registry(size_t budget = SIZE_MAX) noexcept;
+    memory_registry(memory_registry const &) = delete;
+    memory_registry &operator=(memory_registry const &) = delete;
+    // all members must have left
+    ~memory_registry();
+
+    size_t total_bytes() const noexcept;
+    size_t budget() const noexcept;
+    void set_budget(size_t budget) noexcept;
+    void set_over_budget_handler(over_budget_handler handler);
+    size_t member_count() const noexcept;
+
+    // Shrinks every member that has not been used since the previous call
+    // to the smallest capacity holding its elements and frees the buffers
+    // of empty ones. Returns the number of bytes released.
+    size_t trim_idle() noexcept;
+
+private:
+    friend class deque_memory_member;
+
+    void charge(size_t old_bytes, size_t new_bytes);
+
+    size_t budget_;
+    size_t total_bytes_ = 0;
+    size_t member_count_ = 0;
+    // bumped by trim_idle; members remember the value of their last use
+    size_t generation_ = 1;
+    over_budget_handler handler_;
+    deque_memory_member *first_ = nullptr;
+};
+
+// The part of the tracking policy that does not depend on the element type:
+// the registry links, the bytes this deque holds and its last use.
+class deque_memory_member {
+public:
+    memory_registry *registry() const noexcept {
+        return registry_;
+    }
+
+    size_t held_bytes() const noexcept {
+        return held_bytes_;
+    }
+
+protected:
+    using trim_function = void (*)(deque_memory_member &);
+
+    deque_memory_member() noexcept = default;
+    deque_memory_member(deque_memory_member const &) = delete;
+    deque_memory_member &operator=(deque_memory_member const &) = delete;
+    ~deque_memory_member();
+
+    // checked against the budget unless charge is false
+    void join(memory_registry &registry, trim_function trim, bool charge = true);
+    void leave() noexcept;
+
+    void touch() noexcept {
+        if (registry_) {
+            last_used_ = registry_->generation_;
+        }
+    }
+
+    // The deque counts as used from here on, so an over-budget handler that
+    // trims idle deques never trims the one that is reallocating.
+    void check_budget(size_t old_bytes, size_t new_bytes) {
+        touch();
+        if (registry_ && new_bytes > old_bytes) {
+            registry_->charge(old_bytes, new_bytes);
+        }
+    }
+
+    // the buffer now takes held bytes, whatever it took before
+    void set_held(size_t held) noexcept;
+
+private:
+    friend class memory_registry;
+
+    memory_registry *registry_ = nullptr;
+    deque_memory_member *prev_ = nullptr;
+    deque_memory_member *next_ = nullptr;
+    trim_function trim_ = nullptr;
+    size_t held_bytes_ = 0;
+    size_t last_used_ = 0;
+};
+
+// my_deque policy that reports reallocations and uses to the registry the
+// deque joined, on top of the hooks of the wrapped stats policy.
+template<typename Stats = deque_stats_disabled>
+class deque_memory_tracking : public Stats, public deque_memory_member {
+protected:
+    void before_reallocate(size_t old_bytes, size_t new_bytes) {
+        Stats::before_reallocate(old_bytes, new_bytes);
+        check_budget(old_bytes, new_bytes);
+    }
+
+    void on_push_back(size_t new_size) noexcept {
+        Stats::on_push_back(new_size);
+        touch();
+    }
+
+    void on_push_front(size_t new_size) noexcept {
+        Stats::on_push_front(new_size);
+        touch();
+    }
+
+    void on_pop_back() noexcept {
+        Stats::on_pop_back();
+        touch();
+    }
+
+    void on_pop_front() noexcept {
+        Stats::on_pop_front();
+        touch();
+    }
+
+    void on_push_back(size_t count, size_t new_size) noexcept {
+        Stats::on_push_back(count, new_size);
+        touch();
+    }
+
+    void on_pop_back(size_t count) noexcept {
+        Stats::on_pop_back(count);
+        touch();
+    }
+
+    void on_pop_front(size_t count) noexcept {
+        Stats::on_pop_front(count);
+        touch();
+    }
+
+    void on_reallocate(size_t relocated, size_t bytes_allocated, size_t bytes_freed, size_t new_capacity) noexcept {
+        Stats::on_reallocate(relocated, bytes_allocated, bytes_freed, new_capacity);
+        set_held(held_bytes() + bytes_allocated - bytes_freed);
+    }
+};
+
+// A my_deque that is a member of a memory_registry for its whole lifetime.
+// Copies join the registry of their source; moves and swaps carry the
+// buffer's bytes over to the deque that now holds it.
+template<typename T, typename Stats = deque_stats_disabled>
+class tracked_deque : public my_deque<T, deque_memory_tracking<Stats>> {
+    using base = my_deque<T, deque_memory_tracking<Stats>>;
+
+public:
+    explicit tracked_deque(memory_registry &registry) {
+        this->join(registry, &trim_);
+    }
+
+    tracked_deque(tracked_deque const &other) : base(other) {
+        set_held_from_capacity_();
+        this->join(*other.registry(), &trim_);
+    }
+
+    tracked_deque(tracked_deque &&other) noexcept : base(std::move(other)) {
+        set_held_from_capacity_();
+        other.set_held_from_capacity_();
+        this->join(*other.registry(), &trim_, false);
+    }
+
+    tracked_deque &operator=(tracked_deque const &other) {
+        this->check_budget(0, buffer_bytes_(other));
+        base::operator=(other);
+        set_held_from_capacity_();
+        return *this;
+    }
+
+    tracked_deque &operator=(tracked_deque &&other) noexcept {
+        base::operator=(std::move(other));
+        set_held_from_capacity_();
+        other.set_held_from_capacity_();
+        return *this;
+    }
+
+    ~tracked_deque() {
+        this->leave();
+    }
+
+    friend void swap(tracked_deque &a, tracked_deque &b) noexcept {
+        swap(static_cast<base &>(a), static_cast<base &>(b));
+        a.set_held_from_capacity_();
+        b.set_held_from_capacity_();
+    }
+
+private:
+    // from memory_usage(), which knows how the buffer is laid out:
+    // capacity() counts bits for tracked_deque<bool>
+    static size_t buffer_bytes_(base const &c) noexcept {
+        my_deque_memory m = c.memory_usage();
+        return m.payload_bytes + m.slack_bytes;
+    }
+
+    void set_held_from_capacity_() noexcept {
+        this->set_held(buffer_bytes_(*this));
+    }
+
+    static void trim_(deque_memory_member &member) {
+        static_cast<tracked_deque &>(member).shrink_to_fit();
+    }
+};
+
+#endif //EXAM_DEQUE_MEMORY_BUDGET_H
@@ -0,0 +1,179 @@
+#include "multires_ring.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+void series_summary::add(double value) noexcept {
+    count++;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void series_summary::merge(series_summary const &other) noexcept {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double series_summary::mean() const noexcept {
+    return count == 0 ? 0 : sum / double(count);
+}
+
+std::vector<multires_level> multires_ring::default_levels() {
+    return {{1000, 3600}, {60 * 1000, 24 * 60}, {3600 * 1000, 90 * 24}};
+}
+
+multires_ring::multires_ring(size_t raw_capacity, std::vector<multires_level> levels)
+        : raw_capacity_(raw_capacity) {
+    if (raw_capacity == 0) {
+        throw std::invalid_argument("multires_ring: raw capacity must not be 0");
+    }
+    uint64_t previous = 1;
+    for (multires_level const &l : levels) {
+        bool grows = levels_.empty() || (l.resolution > previous && l.resolution % previous == 0);
+        if (l.capacity == 0 || l.resolution == 0 || !grows) {
+            throw std::invalid_argument("multires_ring: resolutions must grow by whole multiples");
+        }
+        previous = l.resolution;
+        level lv;
+        lv.resolution = l.resolution;
+        lv.capacity = l.capacity;
+        levels_.push_back(std::move(lv));
+    }
+}
+
+void multires_ring::push(uint64_t time, double value) {
+    if (!raw_.empty() && time < raw_.back().time) {
+        throw std::invalid_argument("multires_ring: time goes backwards");
+    }
+    if (!levels_.empty()) {
+        uint64_t boundary = floor_(time, levels_.front().resolution);
+        if (boundary > raw_fed_) {
+            feed_raw_(boundary);
+        }
+    }
+    if (raw_.size() == raw_capacity_) {
+        // the oldest sample must reach level 1 before it is dropped
+        uint64_t oldest = raw_.front().time;
+        if (!levels_.empty() && oldest >= raw_fed_) {
+            feed_raw_(oldest + 1);
+        }
+        raw_.pop_front();
+        raw_begin_ = oldest + 1;
+    }
+    raw_.push_back(time, value);
+    if (!levels_.empty() && time < raw_fed_) {
+        // a time that was already fed ahead of a drop; it will not be
+        // picked up by feed_raw_ any more
+        series_summary single;
+        single.add(value);
+        feed_(0, time, raw_fed_, single);
+    }
+}
+
+series_summary multires_ring::query(uint64_t from, uint64_t to) const {
+    return answer_(levels_.size(), from, to);
+}
+
+size_t multires_ring::level_count() const noexcept {
+    return levels_.size() + 1;
+}
+
+size_t multires_ring::level_size(size_t index) const noexcept {
+    if (index == 0) {
+        return raw_.size();
+    }
+    level const &l = levels_[index - 1];
+    return l.buckets.size() + (l.open.count != 0);
+}
+
+void multires_ring::feed_raw_(uint64_t before) {
+    uint64_t resolution = levels_.front().resolution;
+    deque_spans<timed_deque<double>::entry const> runs = raw_.range(raw_fed_, before);
+    series_summary batch;
+    uint64_t start = 0;
+    for (deque_span<timed_deque<double>::entry const> run : {runs.first, runs.second}) {
+        for (auto const &e : run) {
+            uint64_t bucket = floor_(e.time, resolution);
+            if (batch.count != 0 && bucket != start) {
+                feed_(0, start, start + resolution, batch);
+                batch = series_summary();
+            }
+            start = bucket;
+            batch.add(e.value);
+        }
+    }
+    if (batch.count != 0) {
+        feed_(0, start, before, batch);
+    }
+    raw_fed_ = before;
+}
+
+void multires_ring::feed_(size_t index, uint64_t start, uint64_t end, series_summary const &summary) {
+    level &l = levels_[index];
+    uint64_t bucket = floor_(start, l.resolution);
+    if (l.open.count != 0 && l.open_start != bucket) {
+        seal_(index);
+    }
+    if (l.open.count == 0) {
+        l.open_start = bucket;
+    }
+    l.open.merge(summary);
+    l.end = std::max(l.end, end);
+}
+
+void multires_ring::seal_(size_t index) {
+    level &l = levels_[index];
+    if (l.buckets.size() == l.capacity) {
+        l.begin = l.buckets.front().time + l.resolution;
+        l.buckets.pop_front();
+    }
+    l.buckets.push_back(l.open_start, l.open);
+    if (index + 1 < levels_.size()) {
+        feed_(index + 1, l.open_start, l.open_start + l.resolution, l.open);
+    }
+    l.open = series_summary();
+}
+
+series_summary multires_ring::answer_(size_t index, uint64_t from, uint64_t to) const {
+    series_summary res;
+    if (from >= to) {
+        return res;
+    }
+    if (index == 0) {
+        deque_spans<timed_deque<double>::entry const> runs = raw_.range(from, to);
+        for (deque_span<timed_deque<double>::entry const> run : {runs.first, runs.second}) {
+            for (auto const &e : run) {
+                res.add(e.value);
+            }
+        }
+        return res;
+    }
+
+    // whole buckets of this level inside [from, to), [a, b)
+    level const &l = levels_[index - 1];
+    uint64_t r = l.resolution;
+    uint64_t finer_begin = index == 1 ? raw_begin_ : levels_[index - 2].begin;
+    uint64_t a = from < finer_begin || from % r == 0 ? floor_(from, r) : floor_(from, r) + r;
+    a = std::max(a, floor_(l.begin + r - 1, r));
+    uint64_t b = std::min(floor_(to, r), floor_(l.end, r));
+    if (a >= b) {
+        return answer_(index - 1, from, to);
+    }
+
+    res = answer_(index - 1, from, a);
+    deque_spans<timed_deque<series_summary>::entry const> runs = l.buckets.range(a, b);
+    for (deque_span<timed_deque<series_summary>::entry const> run : {runs.first, runs.second}) {
+        for (auto const &e : run) {
+            res.merge(e.value);
+        }
+    }
+    if (l.open.count != 0 && l.open_start >= a && l.open_start < b) {
+        res.merge(l.open);
+    }
+    res.merge(answer_(index - 1, b, to));
+    return res;
+}
@@ -0,0 +1,93 @@
+#ifndef EXAM_DEQUE_MULTIRES_RING_H
+#define EXAM_DEQUE_MULTIRES_RING_H
+
+#include "my_deque.h"
+#include "timed_deque.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct series_summary {
+    uint64_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double value) noexcept;
+    void merge(series_summary const &other) noexcept;
+    double mean() const noexcept;
+};
+
+struct multires_level {
+    // bucket width, in the unit of the sample times
+    uint64_t resolution;
+    // buckets kept before the oldest is dropped
+    size_t capacity;
+};
+
+// A time series kept at decreasing resolution with age, in bounded memory.
+// Raw samples go to a fixed-capacity ring; each level above it is a ring of
+// {count, sum, min, max} buckets, fed in batches from the level below: the
+// raw samples of a bucket once time has moved past it (or once the raw ring
+// has to drop them), and the buckets of the level below as they are sealed.
+// Every ring drops its oldest entry when full, since by then the entry has
+// been aggregated into the level above.
+//
+// query() answers from the coarsest level that has whole buckets inside
+// the range and goes to finer levels only for the edges, so a query over
+// days touches a few hourly buckets plus the minutes and seconds at its
+// ends. Where a finer level no longer reaches back to an edge, the coarse
+// bucket holding it is counted whole.
+class multires_ring {
+public:
+    // 1s, 1m and 1h buckets for times in milliseconds: an hour of seconds,
+    // a day of minutes, 90 days of hours
+    static std::vector<multires_level> default_levels();
+
+    // resolutions must increase, each a multiple of the one before
+    explicit multires_ring(size_t raw_capacity = 4096, std::vector<multires_level> levels = default_levels());
+
+    // time must not be earlier than that of the newest sample
+    void push(uint64_t time, double value);
+
+    // samples with from <= time < to, as far as they are still kept
+    series_summary query(uint64_t from, uint64_t to) const;
+
+    // 0 is the raw ring
+    size_t level_count() const noexcept;
+    size_t level_size(size_t level) const noexcept;
+
+private:
+    struct level {
+        uint64_t resolution = 0;
+        size_t capacity = 0;
+        timed_deque<series_summary> buckets;
+        // the bucket still being fed, not yet in buckets
+        uint64_t open_start = 0;
+        series_summary open;
+        // complete from begin on, and holds everything fed before end
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    static uint64_t floor_(uint64_t time, uint64_t resolution) noexcept {
+        return time - time % resolution;
+    }
+
+    // aggregates raw samples from raw_fed_ up to before into level 1
+    void feed_raw_(uint64_t before);
+    void feed_(size_t index, uint64_t start, uint64_t end, series_summary const &summary);
+    void seal_(size_t index);
+    series_summary answer_(size_t index, uint64_t from, uint64_t to) const;
+
+    size_t raw_capacity_;
+    timed_deque<double> raw_;
+    uint64_t raw_begin_ = 0;
+    uint64_t raw_fed_ = 0;
+    // levels_[0] is level 1
+    my_deque<level> levels_;
+};
+
+#endif //EXAM_DEQUE_MULTIRES_RING_H
@@ -15,8 +15,155 @@
 #include "deque"
 
 
+struct my_deque_stats {
+    size_t push_back = 0;
+    size_t push_front = 0;
+    size_t pop_back = 0;
+    size_t pop_front = 0;
+    size_t reallocations = 0;
+    size_t relocated = 0;
+    size_t bytes_allocated = 0;
+    size_t bytes_freed = 0;
+    size_t peak_size = 0;
+    size_t peak_capacity = 0;
+};
+
+struct my_deque_memory {
+    size_t payload_bytes = 0;
+    size_t slack_bytes = 0;
+    size_t header_bytes = 0;
+
+    size_t total_bytes() const noexcept {
+        return payload_bytes + slack_bytes + header_bytes;
+    }
+};
+
+// Stats policies for my_deque. The default one is empty and all of its hooks
+// are no-ops, so a deque without stats pays nothing for them.
+struct deque_stats_disabled {
+    static constexpr bool enabled = false;
+
+    my_deque_stats stats() const noexcept {
+        return my_deque_stats();
+    }
+
+protected:
+    // called before a reallocation from old_bytes to new_bytes; a policy may
+    // throw here to fail the reserve before anything is changed
+    void before_reallocate(size_t, size_t) noexcept {}
+    void on_push_back(size_t) noexcept {}
+    void on_push_front(size_t) noexcept {}
+    void on_pop_back() noexcept {}
+    void on_pop_front() noexcept {}
+    // bulk operations report all their elements in one call
+    void on_push_back(size_t, size_t) noexcept {}
+    void on_pop_back(size_t) noexcept {}
+    void on_pop_front(size_t) noexcept {}
+    void on_reallocate(size_t, size_t, size_t, size_t) noexcept {}
+};
+
+struct deque_stats_enabled {
+    static constexpr bool enabled = true;
+
+    my_deque_stats stats() const noexcept {
+        return stats_;
+    }
+
+    void reset_stats() noexcept {
+        stats_ = my_deque_stats();
+    }
+
+protected:
+    void before_reallocate(size_t, size_t) noexcept {}
+
+    void on_push_back(size_t new_size) noexcept {
+        stats_.push_back++;
+        stats_.peak_size = std::max(stats_.peak_size, new_size);
+    }
+
+    void on_push_front(size_t new_size) noexcept {
+        stats_.push_front++;
+        stats_.peak_size = std::max(stats_.peak_size, new_size);
+    }
+
+    void on_pop_back() noexcept {
+        stats_.pop_back++;
+    }
+
+    void on_pop_front() noexcept {
+        stats_.pop_front++;
+    }
+
+    void on_push_back(size_t count, size_t new_size) noexcept {
+        stats_.push_back += count;
+        stats_.peak_size = std::max(stats_.peak_size, new_size);
+    }
+
+    void on_pop_back(size_t count) noexcept {
+        stats_.pop_back += count;
+    }
+
+    void on_pop_front(size_t count) noexcept {
+        stats_.pop_front += count;
+    }
+
+    void on_reallocate(size_t relocated, size_t bytes_allocated, size_t bytes_freed, size_t new_capacity) noexcept {
+        stats_.reallocations++;
+        stats_.relocated += relocated;
+        stats_.bytes_allocated += bytes_allocated;
+        stats_.bytes_freed += bytes_freed;
+        stats_.peak_capacity = std::max(stats_.peak_capacity, new_capacity);
+    }
+
+private:
+    my_deque_stats stats_;
+};
+
+
+// Where my_deque buffers come from. The default one is the global heap.
+struct deque_heap_storage {
+    static void *allocate(size_t bytes) {
+        return operator new(bytes);
+    }
+
+    static void deallocate(void *ptr, size_t) noexcept {
+        operator delete(ptr);
+    }
+};
+
+// A contiguous run of elements. A ring holds its elements in at most two
+// of them: from the head to the end of the buffer, then from its start.
+template<typename T>
+struct deque_span {
+    T *data = nullptr;
+    size_t size = 0;
+
+    T *begin() const noexcept {
+        return data;
+    }
+
+    T *end() const noexcept {
+        return data + size;
+    }
+
+    bool empty() const noexcept {
+        return size == 0;
+    }
+
+    T &operator[](size_t index) const noexcept {
+        return data[index];
+    }
+};
+
 template<typename T>
-class my_deque {
+struct deque_spans {
+    deque_span<T> first;
+    deque_span<T> second;
+};
+
+
+template<typename T, typename Stats = deque_stats_disabled, typename Storage = deque_heap_storage>
+class my_deque : public Stats {
 
     template<typename _Tp>
     struct RA_iterator {
@@ -30,28 +177,14 @@ class my_deque {
         friend class my_deque;
 
     private:
-        RA_iterator(size_t pos, size_t start, size_t capacity, pointer data)
-                : pos(pos),
-                  start_(start),
-                  capacity_(capacity),
+        RA_iterator(size_t pos, size_t start, size_t mask, pointer data)
+                : start_(start),
+                  pos(pos),
+                  mask_(mask),
                   data_(data) {}
 
-        size_t cycle_add(size_t val, ptrdiff_t delta) const {
-            ptrdiff_t signed_val = val;
-            signed_val += delta;
-            signed_val %= capacity_;
-            if (signed_val < 0) {
-                signed_val += capacity_;
-            }
-            return static_cast<size_t>(signed_val);
-        }
-
-        void inc_start() {
-            start_ = cycle_add(start_, 1);
-        }
-
-        void dec_start() {
-            start_ = cycle_add(start_, -1);
+        size_t slot() const {
+            return (start_ + pos) & mask_;
         }
 
     public:
@@ -61,7 +194,7 @@ class my_deque {
                                             std::is_const<_Tp>::value>::type * = nullptr) {
             pos = other.pos;
             data_ = other.data_;
-            capacity_ = other.capacity_;
+            mask_ = other.mask_;
             start_ = other.start_;
         };
 
@@ -87,12 +220,12 @@ class my_deque {
             return res;
         }
 
-        reference operator*() {
-            return data_[cycle_add(start_, pos)];
+        reference operator*() const {
+            return data_[slot()];
         }
 
-        pointer operator->() {
-            return data_ + cycle_add(start_, pos);
+        pointer operator->() const {
+            return data_ + slot();
         }
 
         RA_iterator &operator+=(difference_type diff) {
@@ -155,7 +288,7 @@ class my_deque {
     private:
         size_t start_;
         size_t pos;
-        size_t capacity_;
+        size_t mask_;
         pointer data_;
     };
 
@@ -169,16 +302,24 @@ public:
     explicit my_deque(size_t size);
     my_deque(size_t size, T const &value);
     my_deque(my_deque const &other);
+    my_deque(my_deque &&other) noexcept;
     my_deque &operator=(my_deque const &other);
+    my_deque &operator=(my_deque &&other) noexcept;
     ~my_deque();
 
     void resize(size_t new_size, T const &value);
     void reserve(size_t new_capacity);
+    // smallest capacity that holds size(); an empty deque frees its buffer
+    void shrink_to_fit();
 
     void push_back(T const &value);
+    void push_back(T &&value);
     void push_front(T const &value);
+    void push_front(T &&value);
     void pop_back();
     void pop_front();
+    // pops the first count elements at once
+    void consume_front(size_t count) noexcept;
 
     T &back() noexcept;
     T const &back() const noexcept;
@@ -191,8 +332,17 @@ public:
 
     bool empty() const noexcept;
     size_t size() const noexcept;
+    size_t capacity() const noexcept;
     void clear() noexcept;
 
+    // live elements, unused slots of the ring and the deque object itself
+    my_deque_memory memory_usage() const noexcept;
+
+    // the elements in order as one or two contiguous runs; the second is
+    // empty unless the ring wraps
+    deque_spans<T> spans() noexcept;
+    deque_spans<T const> spans() const noexcept;
+
     iterator insert(const_iterator pos, T const &val);
 
     iterator erase(const_iterator pos);
@@ -207,18 +357,32 @@ public:
     const_reverse_iterator rbegin() const;
     const_reverse_iterator rend() const;
 
-    template<typename T1>
-    friend void swap(my_deque<T1> &a, my_deque<T1> &b);
+    template<typename T1, typename Stats1, typename Storage1>
+    friend void swap(my_deque<T1, Stats1, Storage1> &a, my_deque<T1, Stats1, Storage1> &b);
 
 private:
     struct Deleter {
+        size_t bytes;
+
         void operator()(T *ptr) {
-            operator delete(ptr);
+            Storage::deallocate(ptr, bytes);
         }
     };
 
     using storage_pointer = std::unique_ptr<T, Deleter>;
 
+    // Growth moves elements when that cannot throw (or when there is no
+    // other way) and copies them otherwise, so a failed reserve leaves the
+    // old buffer intact.
+    template<typename It>
+    static void relocate_(It first, It last, T *dest) {
+        if constexpr (std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value) {
+            std::uninitialized_move(first, last, dest);
+        } else {
+            std::uninitialized_copy(first, last, dest);
+        }
+    }
+
     void del_range_(iterator _begin, iterator _end) {
         for (auto it = _begin; it != _end; ++it) {
             it->~T();
@@ -226,256 +390,404 @@ private:
     }
 
     void fix_capacity() {
-        if (size_ >= begin_.capacity_) {
-            reserve(std::max(size_t(2), 2 * begin_.capacity_));
-        } else if (size_ <= begin_.capacity_ / 4) {
-            reserve(begin_.capacity_ / 2);
+        size_t cap = capacity();
+        if (size_ >= cap) {
+            reserve(std::max(size_t(2), 2 * cap));
+        } else if (size_ <= cap / 4) {
+            reserve(cap / 2);
         }
     }
 
-    storage_pointer data_;
-    size_t size_;
-    iterator begin_;
+    // Capacities are powers of two, so a position maps to its slot with a
+    // mask, and (head_ - 1) wraps correctly even though it is unsigned.
+    size_t mask_() const noexcept {
+        return capacity() - 1;
+    }
+
+    T &slot_(size_t index) const noexcept {
+        return data_[(head_ + index) & mask_()];
+    }
+
+    void dec_head_() noexcept {
+        head_ = (head_ - 1) & mask_();
+    }
+
+    void inc_head_() noexcept {
+        head_ = (head_ + 1) & mask_();
+    }
+
+    // Three words: millions of deques are held by callers, so the capacity
+    // is kept as its log2 next to the size rather than in a word of its own.
+    // A null data_ means capacity 0.
+    T *data_;
+    size_t head_;
+    size_t size_ : 58;
+    size_t log_capacity_ : 6;
 };
 
-template<typename T>
-my_deque<T>::my_deque() noexcept
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::my_deque() noexcept
         : data_(nullptr),
+          head_(0),
           size_(0),
-          begin_(0, 0, 0, data_.get()) {}
+          log_capacity_(0) {}
 
 
-template<typename T>
-my_deque<T>::my_deque(size_t size) : my_deque(size, T()) {}
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::my_deque(size_t size) : my_deque(size, T()) {}
 
-template<typename T>
-my_deque<T>::my_deque(size_t size, const T &value) : my_deque() {
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::my_deque(size_t size, const T &value) : my_deque() {
     resize(size, value);
 }
 
-template<typename T>
-my_deque<T>::my_deque(my_deque const &other) : my_deque() {
-    reserve(other.begin_.capacity_);
-    std::uninitialized_copy(other.begin(), other.end(), data_.get());
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::my_deque(my_deque const &other) : my_deque() {
+    reserve(other.capacity());
+    std::uninitialized_copy(other.begin(), other.end(), data_);
     size_ = other.size_;
 }
 
-template<typename T>
-my_deque<T> &my_deque<T>::operator=(my_deque const &other) {
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::my_deque(my_deque &&other) noexcept : my_deque() {
+    swap(*this, other);
+}
+
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage> &my_deque<T, Stats, Storage>::operator=(my_deque const &other) {
     my_deque tmp(other);
     swap(tmp, *this);
     return *this;
 }
 
-template<typename T>
-my_deque<T>::~my_deque() {
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage> &my_deque<T, Stats, Storage>::operator=(my_deque &&other) noexcept {
+    my_deque tmp(std::move(other));
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename T, typename Stats, typename Storage>
+my_deque<T, Stats, Storage>::~my_deque() {
     clear();
+    if (data_ != nullptr) {
+        Storage::deallocate(data_, capacity() * sizeof(T));
+    }
 }
 
-template<typename T>
-void my_deque<T>::resize(size_t new_size, const T &value) {
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::resize(size_t new_size, const T &value) {
     if (new_size < size_) {
         del_range_(begin() + new_size, end());
         size_ = new_size;
     } else {
-        auto old_end = end();
-        reserve(new_size);
+        // grow geometrically, like push_back: reserving exactly new_size
+        // made every resize by a few elements relocate the whole deque
+        if (new_size > capacity()) {
+            reserve(std::max(new_size, 2 * capacity()));
+        }
+        std::uninitialized_fill(end(), begin() + new_size, value);
         size_ = new_size;
-        std::uninitialized_fill(old_end, end(), value);
     }
 }
 
-template<typename T>
-void my_deque<T>::reserve(size_t new_capacity) {
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::reserve(size_t new_capacity) {
+    new_capacity = std::max<size_t>(new_capacity, size_);
     if (new_capacity == 0){
         return;
     }
-    storage_pointer new_data(static_cast<T*>(operator new(new_capacity * sizeof(T))));
-    size_t move_count = std::min(size_, new_capacity);
+    size_t log_capacity = 0;
+    while ((size_t(1) << log_capacity) < new_capacity) {
+        log_capacity++;
+    }
+    new_capacity = size_t(1) << log_capacity;
+    size_t old_capacity = capacity();
+
+    this->before_reallocate(old_capacity * sizeof(T), new_capacity * sizeof(T));
+    storage_pointer new_data(static_cast<T*>(Storage::allocate(new_capacity * sizeof(T))),
+                             Deleter{new_capacity * sizeof(T)});
     if (data_ != nullptr) {
-        std::uninitialized_copy(begin(), begin() + move_count, new_data.get());
+        relocate_(begin(), end(), new_data.get());
         del_range_(begin(), end());
     }
-    data_.swap(new_data);
-    begin_.data_ = data_.get();
-    begin_.capacity_ = new_capacity;
-    begin_.start_ = 0;
-    begin_.pos = 0;
+    this->on_reallocate(size_, new_capacity * sizeof(T), old_capacity * sizeof(T), new_capacity);
+    if (data_ != nullptr) {
+        Storage::deallocate(data_, old_capacity * sizeof(T));
+    }
+    data_ = new_data.release();
+    head_ = 0;
+    log_capacity_ = log_capacity;
 }
 
-template<typename T>
-void my_deque<T>::push_back(const T &value) {
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::shrink_to_fit() {
+    if (size_ != 0) {
+        if (capacity() / 2 >= size_) {
+            reserve(size_);
+        }
+        return;
+    }
+    if (data_ != nullptr) {
+        size_t old_capacity = capacity();
+        Storage::deallocate(data_, old_capacity * sizeof(T));
+        data_ = nullptr;
+        head_ = 0;
+        log_capacity_ = 0;
+        this->on_reallocate(0, 0, old_capacity * sizeof(T), 0);
+    }
+}
+
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::push_back(const T &value) {
     fix_capacity();
-    new(&operator[](size_)) T(value);
+    new(&slot_(size_)) T(value);
     size_++;
+    this->on_push_back(size_);
 }
 
-template<typename T>
-void my_deque<T>::push_front(const T &value) {
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::push_back(T &&value) {
     fix_capacity();
-    new(&operator[](-1)) T(value);
-    begin_.dec_start();
+    new(&slot_(size_)) T(std::move(value));
     size_++;
+    this->on_push_back(size_);
 }
 
-template<typename T>
-void my_deque<T>::pop_back() {
-    del_range_(end() - 1, end());
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::push_front(const T &value) {
+    fix_capacity();
+    new(&slot_(-1)) T(value);
+    dec_head_();
+    size_++;
+    this->on_push_front(size_);
+}
+
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::push_front(T &&value) {
+    fix_capacity();
+    new(&slot_(-1)) T(std::move(value));
+    dec_head_();
+    size_++;
+    this->on_push_front(size_);
+}
+
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::pop_back() {
+    slot_(size_ - 1).~T();
     size_--;
+    this->on_pop_back();
     //fix_capacity();
 }
 
-template<typename T>
-void my_deque<T>::pop_front() {
-    del_range_(begin(), begin() + 1);
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::pop_front() {
+    slot_(0).~T();
     size_--;
-    begin_.inc_start();
+    inc_head_();
+    this->on_pop_front();
     //fix_capacity();
 }
 
-template<typename T>
-T &my_deque<T>::back() noexcept {
-    return operator[](size_ - 1);
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::consume_front(size_t count) noexcept {
+    if constexpr (!std::is_trivially_destructible<T>::value) {
+        del_range_(begin(), begin() + count);
+    }
+    head_ = (head_ + count) & mask_();
+    size_ -= count;
+    this->on_pop_front(count);
 }
 
-template<typename T>
-T const &my_deque<T>::back() const noexcept {
-    return operator[](size_ - 1);
+template<typename T, typename Stats, typename Storage>
+T &my_deque<T, Stats, Storage>::back() noexcept {
+    return slot_(size_ - 1);
 }
 
-template<typename T>
-T &my_deque<T>::front() noexcept {
-    return *begin();
+template<typename T, typename Stats, typename Storage>
+T const &my_deque<T, Stats, Storage>::back() const noexcept {
+    return slot_(size_ - 1);
 }
 
-template<typename T>
-T const &my_deque<T>::front() const noexcept {
-    return *begin();
+template<typename T, typename Stats, typename Storage>
+T &my_deque<T, Stats, Storage>::front() noexcept {
+    return slot_(0);
 }
 
-template<typename T>
-T &my_deque<T>::operator[](ptrdiff_t index) noexcept {
-    return begin()[index];
+template<typename T, typename Stats, typename Storage>
+T const &my_deque<T, Stats, Storage>::front() const noexcept {
+    return slot_(0);
 }
 
-template<typename T>
-T const &my_deque<T>::operator[](ptrdiff_t index) const noexcept {
-    return begin()[index];
+template<typename T, typename Stats, typename Storage>
+T &my_deque<T, Stats, Storage>::operator[](ptrdiff_t index) noexcept {
+    return slot_(index);
 }
 
-template<typename T>
-bool my_deque<T>::empty() const noexcept {
+template<typename T, typename Stats, typename Storage>
+T const &my_deque<T, Stats, Storage>::operator[](ptrdiff_t index) const noexcept {
+    return slot_(index);
+}
+
+template<typename T, typename Stats, typename Storage>
+bool my_deque<T, Stats, Storage>::empty() const noexcept {
     return size_ == 0;
 }
 
-template<typename T>
-size_t my_deque<T>::size() const  noexcept {
+template<typename T, typename Stats, typename Storage>
+size_t my_deque<T, Stats, Storage>::size() const  noexcept {
     return size_;
 }
 
-template<typename T>
-void my_deque<T>::clear() noexcept {
+template<typename T, typename Stats, typename Storage>
+size_t my_deque<T, Stats, Storage>::capacity() const noexcept {
+    return data_ ? size_t(1) << log_capacity_ : 0;
+}
+
+template<typename T, typename Stats, typename Storage>
+my_deque_memory my_deque<T, Stats, Storage>::memory_usage() const noexcept {
+    my_deque_memory res;
+    res.payload_bytes = size_ * sizeof(T);
+    res.slack_bytes = (capacity() - size_) * sizeof(T);
+    res.header_bytes = sizeof(*this);
+    return res;
+}
+
+template<typename T, typename Stats, typename Storage>
+deque_spans<T> my_deque<T, Stats, Storage>::spans() noexcept {
+    deque_spans<T> res;
+    if (data_ != nullptr) {
+        size_t first = std::min<size_t>(size_, capacity() - head_);
+        res.first = {data_ + head_, first};
+        res.second = {data_, size_ - first};
+    }
+    return res;
+}
+
+template<typename T, typename Stats, typename Storage>
+deque_spans<T const> my_deque<T, Stats, Storage>::spans() const noexcept {
+    deque_spans<T> res = const_cast<my_deque *>(this)->spans();
+    return {{res.first.data, res.first.size}, {res.second.data, res.second.size}};
+}
+
+template<typename T, typename Stats, typename Storage>
+void my_deque<T, Stats, Storage>::clear() noexcept {
     if (size_ > 0) {
         resize(0, *begin());
     }
 }
 
-template<typename T>
-typename my_deque<T>::iterator my_deque<T>::insert(my_deque::const_iterator pos, const T &val) {
-    if (pos.get_index() > size() - pos.get_index()) {
-        push_back(val);
-        iterator it = begin_ + pos.get_index();
-        for (; it != end(); ++it) {
-            std::swap(*it, end()[-1]);
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::iterator my_deque<T, Stats, Storage>::insert(my_deque::const_iterator pos, const T &val) {
+    // Only the shorter side of pos is shifted, by one move per element; the
+    // copy is made up front, so val may refer to an element of this deque.
+    size_t index = pos.get_index();
+    T tmp(val);
+    fix_capacity();
+    if (index >= size_ - index) {
+        if (index == size_) {
+            new(&slot_(size_)) T(std::move_if_noexcept(tmp));
+            size_++;
+        } else {
+            new(&slot_(size_)) T(std::move_if_noexcept(back()));
+            size_++;
+            std::move_backward(begin() + index, end() - 2, end() - 1);
+            operator[](index) = std::move(tmp);
         }
-    }
-    else {
-        push_front(val);
-        reverse_iterator rit = reverse_iterator(begin_ + pos.get_index() + 1);
-        for (; rit != rend(); ++rit) {
-            std::swap(*rit, rend()[-1]);
+        this->on_push_back(size_);
+    } else {
+        if (index == 0) {
+            new(&slot_(-1)) T(std::move_if_noexcept(tmp));
+            dec_head_();
+            size_++;
+        } else {
+            new(&slot_(-1)) T(std::move_if_noexcept(front()));
+            dec_head_();
+            size_++;
+            std::move(begin() + 2, begin() + index + 1, begin() + 1);
+            operator[](index) = std::move(tmp);
         }
+        this->on_push_front(size_);
     }
-    return begin_ + pos.get_index();
+    return begin() + index;
 }
 
-template<typename T>
-typename my_deque<T>::iterator my_deque<T>::erase(my_deque::const_iterator pos) {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::iterator my_deque<T, Stats, Storage>::erase(my_deque::const_iterator pos) {
     return erase(pos, pos + 1);
 }
 
-template<typename T>
-typename my_deque<T>::iterator my_deque<T>::erase(my_deque::const_iterator first, my_deque::const_iterator last) {
-    auto res = last;
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::iterator my_deque<T, Stats, Storage>::erase(my_deque::const_iterator first, my_deque::const_iterator last) {
     ptrdiff_t range_size = last - first;
-    iterator start = begin_ + first.get_index();
-    iterator finish = begin_ + last.get_index();
+    iterator start = begin() + first.get_index();
+    iterator finish = begin() + last.get_index();
     if (end() - finish < start - begin()) {
-        for (iterator it = start; it + range_size != end(); it++) {
-            std::swap(*it, it[range_size]);
-        }
+        std::move(finish, end(), start);
         while (range_size-- > 0) {
             pop_back();
         }
-    }
-    else{
-        reverse_iterator rstart = reverse_iterator(finish);
-        for (reverse_iterator rit = rstart; rit + range_size != rend(); rit++) {
-            std::swap(*rit, rit[range_size]);
-        }
+    } else {
+        std::move_backward(begin(), start, finish);
         while (range_size-- > 0) {
             pop_front();
         }
     }
-    return start;
+    return begin() + first.get_index();
 }
 
-template<typename T>
-typename my_deque<T>::iterator my_deque<T>::begin() {
-    return begin_;
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::iterator my_deque<T, Stats, Storage>::begin() {
+    return iterator(0, head_, mask_(), data_);
 }
 
-template<typename T>
-typename my_deque<T>::iterator my_deque<T>::end() {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::iterator my_deque<T, Stats, Storage>::end() {
     return begin() + size_;
 }
 
-template<typename T>
-typename my_deque<T>::reverse_iterator my_deque<T>::rbegin() {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::reverse_iterator my_deque<T, Stats, Storage>::rbegin() {
     return my_deque::reverse_iterator(end());
 }
 
-template<typename T>
-typename my_deque<T>::reverse_iterator my_deque<T>::rend() {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::reverse_iterator my_deque<T, Stats, Storage>::rend() {
     return my_deque::reverse_iterator(begin());
 }
 
-template<typename T>
-typename my_deque<T>::const_iterator my_deque<T>::begin() const {
-    return my_deque::const_iterator(begin_);
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::const_iterator my_deque<T, Stats, Storage>::begin() const {
+    return my_deque::const_iterator(0, head_, mask_(), data_);
 }
 
-template<typename T>
-typename my_deque<T>::const_iterator my_deque<T>::end() const {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::const_iterator my_deque<T, Stats, Storage>::end() const {
     return begin() + size_;
 }
 
-template<typename T>
-typename my_deque<T>::const_reverse_iterator my_deque<T>::rbegin() const {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::const_reverse_iterator my_deque<T, Stats, Storage>::rbegin() const {
     return my_deque::const_reverse_iterator(end());
 }
 
-template<typename T>
-typename my_deque<T>::const_reverse_iterator my_deque<T>::rend() const {
+template<typename T, typename Stats, typename Storage>
+typename my_deque<T, Stats, Storage>::const_reverse_iterator my_deque<T, Stats, Storage>::rend() const {
     return my_deque::const_reverse_iterator(begin());
 }
 
-template<typename T>
-void swap(my_deque<T> &a, my_deque<T> &b) {
+template<typename T, typename Stats, typename Storage>
+void swap(my_deque<T, Stats, Storage> &a, my_deque<T, Stats, Storage> &b) {
     std::swap(a.data_, b.data_);
-    std::swap(a.size_, b.size_);
-    std::swap(a.begin_, b.begin_);
+    std::swap(a.head_, b.head_);
+    size_t size = a.size_;
+    a.size_ = b.size_;
+    b.size_ = size;
+    size_t log_capacity = a.log_capacity_;
+    a.log_capacity_ = b.log_capacity_;
+    b.log_capacity_ = log_capacity;
 }
 
+#include "my_deque_bool.h"
 
 #endif //EXAM_DEQUE_MY_DEQUE_H
@@ -0,0 +1,683 @@
+#ifndef EXAM_DEQUE_MY_DEQUE_BOOL_H
+#define EXAM_DEQUE_MY_DEQUE_BOOL_H
+
+// Included by my_deque.h after the primary template; not meant to be
+// included on its own.
+
+#include <cstdint>
+
+// my_deque<bool> keeps one bit per element. The ring is a power-of-two
+// number of bits in a power-of-two number of 64-bit words, so the 64 bits
+// starting at any position are two word loads, the second one from the
+// next word of the ring (wrapping at the last). count, find and growth work
+// on such 64-bit windows, and the bulk pops only move head_ and size_.
+//
+// As with std::vector<bool>, elements are not objects: operator[] and the
+// iterators hand out a proxy reference, and front()/back() on a const
+// deque return bool by value.
+template<typename Stats, typename Storage>
+class my_deque<bool, Stats, Storage> : public Stats {
+
+    static constexpr size_t word_bits = 64;
+    static constexpr size_t min_capacity = word_bits;
+
+public:
+    class reference {
+    public:
+        operator bool() const noexcept {
+            return (*word_ & bit_) != 0;
+        }
+
+        reference &operator=(bool value) noexcept {
+            if (value) {
+                *word_ |= bit_;
+            } else {
+                *word_ &= ~bit_;
+            }
+            return *this;
+        }
+
+        reference &operator=(reference const &other) noexcept {
+            return *this = bool(other);
+        }
+
+        void flip() noexcept {
+            *word_ ^= bit_;
+        }
+
+    private:
+        friend class my_deque;
+
+        reference(uint64_t *word, uint64_t bit) noexcept : word_(word), bit_(bit) {}
+
+        uint64_t *word_;
+        uint64_t bit_;
+    };
+
+    using const_reference = bool;
+
+private:
+    template<bool Const>
+    struct bit_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef bool value_type;
+        typedef ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef typename std::conditional<Const, bool, my_deque::reference>::type reference;
+
+        friend class my_deque;
+
+    private:
+        bit_iterator(size_t pos, size_t start, size_t mask, uint64_t *data)
+                : start_(start),
+                  pos(pos),
+                  mask_(mask),
+                  data_(data) {}
+
+    public:
+        bit_iterator() : start_(0), pos(0), mask_(0), data_(nullptr) {}
+
+        template<bool C, typename = typename std::enable_if<Const && !C>::type>
+        bit_iterator(bit_iterator<C> const &other)
+                : start_(other.start_),
+                  pos(other.pos),
+                  mask_(other.mask_),
+                  data_(other.data_) {}
+
+        reference operator*() const {
+            size_t slot = (start_ + pos) & mask_;
+            return my_deque::bit_at_(data_, slot);
+        }
+
+        reference operator[](difference_type diff) const {
+            return *(*this + diff);
+        }
+
+        bit_iterator &operator++() {
+            pos++;
+            return *this;
+        }
+
+        bit_iterator operator++(int) {
+            auto res = *this;
+            ++(*this);
+            return res;
+        }
+
+        bit_iterator &operator--() {
+            pos--;
+            return *this;
+        }
+
+        bit_iterator operator--(int) {
+            auto res = *this;
+            --(*this);
+            return res;
+        }
+
+        bit_iterator &operator+=(difference_type diff) {
+            pos += diff;
+            return *this;
+        }
+
+        bit_iterator &operator-=(difference_type diff) {
+            pos -= diff;
+            return *this;
+        }
+
+        size_t get_index() const {
+            return pos;
+        }
+
+        friend bit_iterator operator+(bit_iterator it, difference_type diff) {
+            return it += diff;
+        }
+
+        friend bit_iterator operator-(bit_iterator it, difference_type diff) {
+            return it -= diff;
+        }
+
+        friend difference_type operator-(bit_iterator const &a, bit_iterator const &b) {
+            assert(a.data_ == b.data_);
+            return difference_type(a.pos - b.pos);
+        }
+
+        friend bool operator<(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos < b.pos;
+        }
+
+        friend bool operator<=(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos <= b.pos;
+        }
+
+        friend bool operator>(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos > b.pos;
+        }
+
+        friend bool operator>=(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos >= b.pos;
+        }
+
+        friend bool operator==(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos == b.pos && a.data_ == b.data_;
+        }
+
+        friend bool operator!=(bit_iterator const &a, bit_iterator const &b) {
+            return a.pos != b.pos || a.data_ != b.data_;
+        }
+
+    private:
+        template<bool C>
+        friend struct bit_iterator;
+
+        size_t start_;
+        size_t pos;
+        size_t mask_;
+        uint64_t *data_;
+    };
+
+public:
+    using iterator = bit_iterator<false>;
+    using const_iterator = bit_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    my_deque() noexcept;
+    explicit my_deque(size_t size);
+    my_deque(size_t size, bool value);
+    my_deque(my_deque const &other);
+    my_deque(my_deque &&other) noexcept;
+    my_deque &operator=(my_deque const &other);
+    my_deque &operator=(my_deque &&other) noexcept;
+    ~my_deque();
+
+    void resize(size_t new_size, bool value);
+    // capacities are whole words: at least 64 bits
+    void reserve(size_t new_capacity);
+    void shrink_to_fit();
+
+    void push_back(bool value);
+    void push_front(bool value);
+    void pop_back();
+    void pop_front();
+
+    // count copies of value at the back, or drop count bits from either
+    // end; the pops are O(1)
+    void push_back(size_t count, bool value);
+    void pop_back(size_t count) noexcept;
+    void pop_front(size_t count) noexcept;
+
+    reference back() noexcept;
+    bool back() const noexcept;
+
+    reference front() noexcept;
+    bool front() const noexcept;
+
+    reference operator[](ptrdiff_t index) noexcept;
+    bool operator[](ptrdiff_t index) const noexcept;
+
+    // set bits among all elements, or among [first, last)
+    size_t count() const noexcept;
+    size_t count(size_t first, size_t last) const noexcept;
+    // index of the first element equal to value at or after from, or size()
+    size_t find(bool value, size_t from = 0) const noexcept;
+    void flip() noexcept;
+    void flip(size_t index) noexcept;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+    size_t capacity() const noexcept;
+    void clear() noexcept;
+
+    my_deque_memory memory_usage() const noexcept;
+
+    iterator insert(const_iterator pos, bool val);
+
+    iterator erase(const_iterator pos);
+    iterator erase(const_iterator first, const_iterator last);
+
+    iterator begin();
+    iterator end();
+    reverse_iterator rbegin();
+    reverse_iterator rend();
+    const_iterator begin() const;
+    const_iterator end() const;
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator rend() const;
+
+    template<typename T1, typename Stats1, typename Storage1>
+    friend void swap(my_deque<T1, Stats1, Storage1> &a, my_deque<T1, Stats1, Storage1> &b);
+
+private:
+    struct Deleter {
+        size_t bytes;
+
+        void operator()(uint64_t *ptr) {
+            Storage::deallocate(ptr, bytes);
+        }
+    };
+
+    using storage_pointer = std::unique_ptr<uint64_t, Deleter>;
+
+    static reference bit_at_(uint64_t *data, size_t slot) noexcept {
+        return reference(data + slot / word_bits, uint64_t(1) << (slot % word_bits));
+    }
+
+    static bool bit_at_(uint64_t const *data, size_t slot) noexcept {
+        return (data[slot / word_bits] >> (slot % word_bits)) & 1;
+    }
+
+    void fix_capacity() {
+        size_t cap = capacity();
+        if (size_ >= cap) {
+            reserve(std::max(min_capacity, 2 * cap));
+        } else if (cap > min_capacity && size_ <= cap / 4) {
+            reserve(cap / 2);
+        }
+    }
+
+    size_t mask_() const noexcept {
+        return capacity() - 1;
+    }
+
+    size_t words_() const noexcept {
+        return capacity() / word_bits;
+    }
+
+    size_t slot_(size_t index) const noexcept {
+        return (head_ + index) & mask_();
+    }
+
+    // the 64 elements starting at index; bits past size() are garbage
+    uint64_t window_(size_t index) const noexcept {
+        size_t slot = slot_(index);
+        size_t word = slot / word_bits;
+        size_t shift = slot % word_bits;
+        uint64_t bits = data_[word] >> shift;
+        if (shift != 0) {
+            bits |= data_[(word + 1) & (words_() - 1)] << (word_bits - shift);
+        }
+        return bits;
+    }
+
+    void set_(size_t index, bool value) noexcept {
+        bit_at_(data_, slot_(index)) = value;
+    }
+
+    static uint64_t low_bits_(size_t n) noexcept {
+        return n >= word_bits ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+    }
+
+    // push_back(count, value) without the stats hook, for resize
+    void append_(size_t count, bool value);
+
+    uint64_t *data_;
+    size_t head_;
+    size_t size_ : 58;
+    size_t log_capacity_ : 6;
+};
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::my_deque() noexcept
+        : data_(nullptr),
+          head_(0),
+          size_(0),
+          log_capacity_(0) {}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::my_deque(size_t size) : my_deque(size, false) {}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::my_deque(size_t size, bool value) : my_deque() {
+    resize(size, value);
+}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::my_deque(my_deque const &other) : my_deque() {
+    if (other.size_ == 0) {
+        return;
+    }
+    reserve(other.size_);
+    for (size_t i = 0; i < other.size_; i += word_bits) {
+        data_[i / word_bits] = other.window_(i);
+    }
+    size_ = other.size_;
+}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::my_deque(my_deque &&other) noexcept : my_deque() {
+    swap(*this, other);
+}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage> &my_deque<bool, Stats, Storage>::operator=(my_deque const &other) {
+    my_deque tmp(other);
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage> &my_deque<bool, Stats, Storage>::operator=(my_deque &&other) noexcept {
+    my_deque tmp(std::move(other));
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename Stats, typename Storage>
+my_deque<bool, Stats, Storage>::~my_deque() {
+    if (data_ != nullptr) {
+        Storage::deallocate(data_, capacity() / 8);
+    }
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::resize(size_t new_size, bool value) {
+    if (new_size <= size_) {
+        size_ = new_size;
+    } else {
+        append_(new_size - size_, value);
+    }
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::reserve(size_t new_capacity) {
+    new_capacity = std::max<size_t>(new_capacity, size_);
+    if (new_capacity == 0) {
+        return;
+    }
+    size_t log_capacity = 6;
+    while ((size_t(1) << log_capacity) < new_capacity) {
+        log_capacity++;
+    }
+    new_capacity = size_t(1) << log_capacity;
+    size_t old_capacity = capacity();
+
+    this->before_reallocate(old_capacity / 8, new_capacity / 8);
+    storage_pointer new_data(static_cast<uint64_t *>(Storage::allocate(new_capacity / 8)),
+                             Deleter{new_capacity / 8});
+    for (size_t i = 0; i < size_; i += word_bits) {
+        new_data.get()[i / word_bits] = window_(i);
+    }
+    this->on_reallocate(size_, new_capacity / 8, old_capacity / 8, new_capacity);
+    if (data_ != nullptr) {
+        Storage::deallocate(data_, old_capacity / 8);
+    }
+    data_ = new_data.release();
+    head_ = 0;
+    log_capacity_ = log_capacity;
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::shrink_to_fit() {
+    if (size_ != 0) {
+        if (capacity() / 2 >= std::max(size_t(size_), min_capacity)) {
+            reserve(size_);
+        }
+        return;
+    }
+    if (data_ != nullptr) {
+        size_t old_capacity = capacity();
+        Storage::deallocate(data_, old_capacity / 8);
+        data_ = nullptr;
+        head_ = 0;
+        log_capacity_ = 0;
+        this->on_reallocate(0, 0, old_capacity / 8, 0);
+    }
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::push_back(bool value) {
+    fix_capacity();
+    set_(size_, value);
+    size_++;
+    this->on_push_back(size_);
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::push_front(bool value) {
+    fix_capacity();
+    head_ = (head_ - 1) & mask_();
+    set_(0, value);
+    size_++;
+    this->on_push_front(size_);
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::pop_back() {
+    size_--;
+    this->on_pop_back();
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::pop_front() {
+    size_--;
+    head_ = (head_ + 1) & mask_();
+    this->on_pop_front();
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::push_back(size_t count, bool value) {
+    if (count == 0) {
+        return;
+    }
+    append_(count, value);
+    this->on_push_back(count, size_);
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::append_(size_t count, bool value) {
+    if (size_ + count > capacity()) {
+        reserve(std::max(size_ + count, 2 * capacity()));
+    }
+    // whole words where the run covers them, single masked words at its ends
+    uint64_t fill = value ? ~uint64_t(0) : 0;
+    size_t index = size_;
+    size_t end = size_ + count;
+    while (index != end) {
+        size_t slot = slot_(index);
+        size_t shift = slot % word_bits;
+        size_t n = std::min(word_bits - shift, end - index);
+        uint64_t bits = low_bits_(n) << shift;
+        uint64_t &word = data_[slot / word_bits];
+        word = (word & ~bits) | (fill & bits);
+        index += n;
+    }
+    size_ = end;
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::pop_back(size_t count) noexcept {
+    size_ -= count;
+    this->on_pop_back(count);
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::pop_front(size_t count) noexcept {
+    size_ -= count;
+    head_ = (head_ + count) & mask_();
+    this->on_pop_front(count);
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::reference my_deque<bool, Stats, Storage>::back() noexcept {
+    return bit_at_(data_, slot_(size_ - 1));
+}
+
+template<typename Stats, typename Storage>
+bool my_deque<bool, Stats, Storage>::back() const noexcept {
+    return bit_at_(static_cast<uint64_t const *>(data_), slot_(size_ - 1));
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::reference my_deque<bool, Stats, Storage>::front() noexcept {
+    return bit_at_(data_, slot_(0));
+}
+
+template<typename Stats, typename Storage>
+bool my_deque<bool, Stats, Storage>::front() const noexcept {
+    return bit_at_(static_cast<uint64_t const *>(data_), slot_(0));
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::reference my_deque<bool, Stats, Storage>::operator[](ptrdiff_t index) noexcept {
+    return bit_at_(data_, slot_(index));
+}
+
+template<typename Stats, typename Storage>
+bool my_deque<bool, Stats, Storage>::operator[](ptrdiff_t index) const noexcept {
+    return bit_at_(static_cast<uint64_t const *>(data_), slot_(index));
+}
+
+template<typename Stats, typename Storage>
+size_t my_deque<bool, Stats, Storage>::count() const noexcept {
+    return count(0, size_);
+}
+
+template<typename Stats, typename Storage>
+size_t my_deque<bool, Stats, Storage>::count(size_t first, size_t last) const noexcept {
+    size_t res = 0;
+    for (size_t i = first; i < last; i += word_bits) {
+        res += size_t(__builtin_popcountll(window_(i) & low_bits_(last - i)));
+    }
+    return res;
+}
+
+template<typename Stats, typename Storage>
+size_t my_deque<bool, Stats, Storage>::find(bool value, size_t from) const noexcept {
+    for (size_t i = from; i < size_; i += word_bits) {
+        uint64_t bits = window_(i);
+        bits = (value ? bits : ~bits) & low_bits_(size_ - i);
+        if (bits != 0) {
+            return i + size_t(__builtin_ctzll(bits));
+        }
+    }
+    return size_;
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::flip() noexcept {
+    // bits outside the live range are garbage anyway
+    for (size_t w = 0; w != words_(); ++w) {
+        data_[w] = ~data_[w];
+    }
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::flip(size_t index) noexcept {
+    bit_at_(data_, slot_(index)).flip();
+}
+
+template<typename Stats, typename Storage>
+bool my_deque<bool, Stats, Storage>::empty() const noexcept {
+    return size_ == 0;
+}
+
+template<typename Stats, typename Storage>
+size_t my_deque<bool, Stats, Storage>::size() const noexcept {
+    return size_;
+}
+
+template<typename Stats, typename Storage>
+size_t my_deque<bool, Stats, Storage>::capacity() const noexcept {
+    return data_ ? size_t(1) << log_capacity_ : 0;
+}
+
+template<typename Stats, typename Storage>
+void my_deque<bool, Stats, Storage>::clear() noexcept {
+    size_ = 0;
+}
+
+template<typename Stats, typename Storage>
+my_deque_memory my_deque<bool, Stats, Storage>::memory_usage() const noexcept {
+    my_deque_memory res;
+    res.payload_bytes = (size_ + 7) / 8;
+    res.slack_bytes = capacity() / 8 - res.payload_bytes;
+    res.header_bytes = sizeof(*this);
+    return res;
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::iterator my_deque<bool, Stats, Storage>::insert(const_iterator pos, bool val) {
+    // shifts the shorter side by one, bit by bit
+    size_t index = pos.get_index();
+    if (index >= size_ - index) {
+        push_back(false);
+        for (size_t i = size_ - 1; i != index; --i) {
+            set_(i, (*this)[ptrdiff_t(i - 1)]);
+        }
+    } else {
+        push_front(false);
+        for (size_t i = 0; i != index; ++i) {
+            set_(i, (*this)[ptrdiff_t(i + 1)]);
+        }
+    }
+    set_(index, val);
+    return begin() + index;
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::iterator my_deque<bool, Stats, Storage>::erase(const_iterator pos) {
+    return erase(pos, pos + 1);
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::iterator my_deque<bool, Stats, Storage>::erase(const_iterator first, const_iterator last) {
+    size_t start = first.get_index();
+    size_t finish = last.get_index();
+    size_t range_size = finish - start;
+    if (size_ - finish < start) {
+        for (size_t i = finish; i != size_; ++i) {
+            set_(i - range_size, (*this)[ptrdiff_t(i)]);
+        }
+        pop_back(range_size);
+    } else {
+        for (size_t i = start; i-- != 0;) {
+            set_(i + range_size, (*this)[ptrdiff_t(i)]);
+        }
+        pop_front(range_size);
+    }
+    return begin() + start;
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::iterator my_deque<bool, Stats, Storage>::begin() {
+    return iterator(0, head_, mask_(), data_);
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::iterator my_deque<bool, Stats, Storage>::end() {
+    return begin() + size_;
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::reverse_iterator my_deque<bool, Stats, Storage>::rbegin() {
+    return reverse_iterator(end());
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::reverse_iterator my_deque<bool, Stats, Storage>::rend() {
+    return reverse_iterator(begin());
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::const_iterator my_deque<bool, Stats, Storage>::begin() const {
+    return const_iterator(0, head_, mask_(), data_);
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::const_iterator my_deque<bool, Stats, Storage>::end() const {
+    return begin() + size_;
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::const_reverse_iterator my_deque<bool, Stats, Storage>::rbegin() const {
+    return const_reverse_iterator(end());
+}
+
+template<typename Stats, typename Storage>
+typename my_deque<bool, Stats, Storage>::const_reverse_iterator my_deque<bool, Stats, Storage>::rend() const {
+    return const_reverse_iterator(begin());
+}
+
+#endif //EXAM_DEQUE_MY_DEQUE_BOOL_H
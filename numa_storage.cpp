@@ -0,0 +1,143 @@
+#include "numa_storage.h"
+
+#include <atomic>
+#include <cstdio>
+#include <new>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    // from <linux/mempolicy.h>
+    int const mpol_bind = 2;
+    unsigned const mpol_f_node = 1 << 0;
+    unsigned const mpol_f_addr = 1 << 1;
+
+    // nodemasks passed to the kernel; more nodes than this are not placed
+    size_t const max_nodes = 1024;
+    size_t const mask_words = max_nodes / (8 * sizeof(unsigned long));
+
+    thread_local int target_node = numa::local_node;
+    std::atomic<size_t> failures(0);
+
+    size_t page_size() {
+        static size_t const size = size_t(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    size_t mapping_bytes(size_t bytes) {
+        return (bytes + page_size() - 1) / page_size() * page_size();
+    }
+
+    // parses a sysfs list like "0-3,8,10-11"; calls f for every entry
+    template<typename F>
+    bool for_each_in_list(char const *path, F f) {
+        std::FILE *file = std::fopen(path, "r");
+        if (!file) {
+            return false;
+        }
+        int first, last;
+        char sep;
+        while (std::fscanf(file, "%d", &first) == 1) {
+            last = first;
+            if (std::fscanf(file, "%c", &sep) == 1 && sep == '-') {
+                if (std::fscanf(file, "%d", &last) != 1) {
+                    break;
+                }
+                std::fscanf(file, "%c", &sep);
+            }
+            for (int i = first; i <= last; ++i) {
+                f(i);
+            }
+        }
+        std::fclose(file);
+        return true;
+    }
+}
+
+namespace numa {
+
+int node_count() noexcept {
+    static int const count = [] {
+        int highest = 0;
+        for_each_in_list("/sys/devices/system/node/possible", [&](int node) {
+            highest = node > highest ? node : highest;
+        });
+        return highest + 1;
+    }();
+    return count;
+}
+
+int current_node() noexcept {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return 0;
+    }
+    return int(node);
+}
+
+int node_of(void const *ptr) noexcept {
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr, mpol_f_node | mpol_f_addr) != 0) {
+        return -1;
+    }
+    return node;
+}
+
+size_t placement_failures() noexcept {
+    return failures.load(std::memory_order_relaxed);
+}
+
+bool run_on_node(int node) noexcept {
+    char path[64];
+    std::snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for_each_in_list(path, [&](int cpu) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+            any = true;
+        }
+    });
+    return any && sched_setaffinity(0, sizeof set, &set) == 0;
+}
+
+placement_scope::placement_scope(int node) noexcept
+        : previous_(target_node) {
+    target_node = node;
+}
+
+placement_scope::~placement_scope() {
+    target_node = previous_;
+}
+
+void *allocate_placed(size_t bytes) {
+    size_t length = mapping_bytes(bytes);
+    void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    int node = target_node == local_node ? current_node() : target_node;
+    unsigned long mask[mask_words] = {};
+    if (node >= 0 && size_t(node) < max_nodes) {
+        mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+        // nothing is touched yet, so binding places every page the
+        // relocation writes; a failure leaves the default first-touch policy
+        if (syscall(SYS_mbind, ptr, length, mpol_bind, mask, max_nodes + 1, 0) != 0) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    return ptr;
+}
+
+void free_placed(void *ptr, size_t bytes) noexcept {
+    munmap(ptr, mapping_bytes(bytes));
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef EXAM_DEQUE_NUMA_STORAGE_H
+#define EXAM_DEQUE_NUMA_STORAGE_H
+
+#include <cstddef>
+
+// NUMA placement of deque buffers through the mbind/getcpu/get_mempolicy
+// syscalls, without libnuma. Placement is a property of the allocating
+// thread: buffers it allocates go to the node of its innermost
+// placement_scope, or to the node it is running on when there is none.
+namespace numa {
+
+int const local_node = -1;
+
+// Buffers smaller than this come from operator new and are not placed:
+// placement works on whole pages and costs a mapping per buffer.
+size_t const min_placed_bytes = size_t(64) << 10;
+
+// number of possible nodes; 1 on machines (or kernels) without NUMA
+int node_count() noexcept;
+// node of the CPU the calling thread runs on
+int current_node() noexcept;
+// node the page holding ptr is on, or -1 if unknown or not yet touched
+int node_of(void const *ptr) noexcept;
+// mbind calls that failed, e.g. for a node that does not exist
+size_t placement_failures() noexcept;
+
+// Pins the calling thread to the CPUs of node. Returns false if the node
+// has no CPUs or the affinity cannot be set.
+bool run_on_node(int node) noexcept;
+
+struct placement_scope {
+    explicit placement_scope(int node) noexcept;
+    placement_scope(placement_scope const &) = delete;
+    placement_scope &operator=(placement_scope const &) = delete;
+    ~placement_scope();
+
+private:
+    int previous_;
+};
+
+// Page-aligned mapping bound to the current placement target; its pages
+// are allocated there on first touch.
+void *allocate_placed(size_t bytes);
+void free_placed(void *ptr, size_t bytes) noexcept;
+
+}
+
+// my_deque storage policy that binds large buffers to the placement target
+// of the allocating thread. Growth relocates the elements into a buffer
+// that is already bound, so they land on the target node; reserving the
+// current capacity under a placement_scope moves a deque to another node.
+struct deque_numa_storage {
+    static void *allocate(size_t bytes) {
+        if (bytes < numa::min_placed_bytes) {
+            return operator new(bytes);
+        }
+        return numa::allocate_placed(bytes);
+    }
+
+    static void deallocate(void *ptr, size_t bytes) noexcept {
+        if (bytes < numa::min_placed_bytes) {
+            operator delete(ptr);
+        } else {
+            numa::free_placed(ptr, bytes);
+        }
+    }
+};
+
+#endif //EXAM_DEQUE_NUMA_STORAGE_H
@@ -0,0 +1,163 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+namespace {
+
+char const *const event_names[perf_event_count] = {
+        "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"};
+
+#ifdef __linux__
+uint64_t cache_config(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+int open_event(perf_event_kind kind) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (kind) {
+        case perf_cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case perf_instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case perf_l1d_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_config(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                       PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case perf_llc_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_config(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                                       PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case perf_branch_misses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case perf_dtlb_misses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache_config(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                       PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+}
+
+perf_counters::perf_counters() {
+    fds_.fill(-1);
+#ifdef __linux__
+    for (int i = 0; i != perf_event_count; ++i) {
+        fds_[i] = open_event(static_cast<perf_event_kind>(i));
+        if (fds_[i] < 0 && error_.empty()) {
+            error_ = std::string(event_names[i]) + ": " + std::strerror(errno);
+        }
+    }
+#else
+    error_ = "perf_event_open is only available on Linux";
+#endif
+}
+
+perf_counters::~perf_counters() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+char const *perf_counters::name(perf_event_kind kind) {
+    return event_names[kind];
+}
+
+bool perf_counters::any_available() const {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void perf_counters::reset() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+#endif
+}
+
+void perf_counters::enable() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void perf_counters::disable() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+}
+
+perf_values perf_counters::read() const {
+    perf_values res;
+    res.fill(0);
+#ifdef __linux__
+    for (int i = 0; i != perf_event_count; ++i) {
+        if (fds_[i] < 0) {
+            continue;
+        }
+        uint64_t buf[3];
+        if (::read(fds_[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) {
+            continue;
+        }
+        double value = static_cast<double>(buf[0]);
+        if (buf[2] < buf[1]) {
+            value *= static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+        }
+        res[i] = value;
+    }
+#endif
+    return res;
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace bench {
+
+enum perf_event_kind {
+    perf_cycles,
+    perf_instructions,
+    perf_l1d_misses,
+    perf_llc_misses,
+    perf_branch_misses,
+    perf_dtlb_misses,
+    perf_event_count
+};
+
+using perf_values = std::array<double, perf_event_count>;
+
+// Hardware counters for the calling thread, read through perf_event_open(2).
+// Each event is opened on its own, so a kernel or PMU that lacks one of them
+// (or a perf_event_paranoid setting that forbids all of them) only marks
+// those counters unavailable instead of failing the benchmark.
+class perf_counters {
+public:
+    perf_counters();
+    ~perf_counters();
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters &operator=(perf_counters const &) = delete;
+
+    static char const *name(perf_event_kind kind);
+
+    bool available(perf_event_kind kind) const {
+        return fds_[kind] >= 0;
+    }
+
+    bool any_available() const;
+
+    // errno description of the first event that failed to open, if any
+    std::string const &error() const {
+        return error_;
+    }
+
+    void reset();
+    void enable();
+    void disable();
+
+    // Counts since the last reset, scaled up for the time the event was
+    // multiplexed out. Unavailable events read as 0.
+    perf_values read() const;
+
+private:
+    std::array<int, perf_event_count> fds_;
+    std::string error_;
+};
+
+}
@@ -0,0 +1,161 @@
+#include "perf_fuzz.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace perf_fuzz {
+
+namespace {
+
+using element = instrumented;
+using deque = my_deque<element, deque_stats_enabled>;
+
+size_t element_ops() {
+    return element::counts.all_moves() + element::counts.all_copies();
+}
+
+}
+
+char const *op_name(op o) {
+    switch (o) {
+        case op::push_back:
+            return "push_back";
+        case op::push_front:
+            return "push_front";
+        case op::pop_back:
+            return "pop_back";
+        case op::pop_front:
+            return "pop_front";
+        case op::insert:
+            return "insert";
+        case op::erase:
+            return "erase";
+        case op::resize:
+            return "resize";
+        case op::clear:
+            return "clear";
+        default:
+            return "?";
+    }
+}
+
+cost run(uint8_t const *data, size_t size) {
+    cost res;
+    deque d;
+
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        op o = static_cast<op>(data[i] % static_cast<uint8_t>(op::count));
+        size_t arg = data[i + 1];
+        size_t n = d.size();
+        size_t work = 1;
+        size_t before = element_ops();
+
+        switch (o) {
+            case op::push_back:
+                if (n == max_size) {
+                    continue;
+                }
+                d.push_back(element(int(arg)));
+                break;
+            case op::push_front:
+                if (n == max_size) {
+                    continue;
+                }
+                d.push_front(element(int(arg)));
+                break;
+            case op::pop_back:
+                if (n == 0) {
+                    continue;
+                }
+                d.pop_back();
+                break;
+            case op::pop_front:
+                if (n == 0) {
+                    continue;
+                }
+                d.pop_front();
+                break;
+            case op::insert: {
+                if (n == max_size) {
+                    continue;
+                }
+                size_t pos = arg * (n + 1) / 256;
+                size_t relocated = d.stats().relocated;
+                d.insert(d.begin() + pos, element(int(arg)));
+                size_t shifted = element_ops() - before - (d.stats().relocated - relocated);
+                // the shifts plus moving the argument into place
+                size_t allowed = std::min(pos, n - pos) + 2;
+                res.excess_shift += shifted > allowed ? shifted - allowed : 0;
+                break;
+            }
+            case op::erase: {
+                if (n == 0) {
+                    continue;
+                }
+                size_t pos = arg * n / 256;
+                d.erase(d.begin() + pos);
+                size_t shifted = element_ops() - before;
+                size_t allowed = std::min(pos, n - pos - 1);
+                res.excess_shift += shifted > allowed ? shifted - allowed : 0;
+                break;
+            }
+            case op::resize: {
+                // small steps around the current size, so sequences can
+                // creep up on a capacity boundary
+                ptrdiff_t target = ptrdiff_t(n) + ptrdiff_t(arg) - 128;
+                size_t new_size = size_t(std::max<ptrdiff_t>(0, std::min<ptrdiff_t>(target, max_size)));
+                d.resize(new_size, element(int(arg)));
+                work = std::max<size_t>(1, new_size > n ? new_size - n : n - new_size);
+                break;
+            }
+            case op::clear:
+                d.clear();
+                work = std::max<size_t>(1, n);
+                break;
+            default:
+                continue;
+        }
+
+        res.ops++;
+        res.work += work;
+        res.max_size = std::max(res.max_size, d.size());
+    }
+
+    my_deque_stats s = d.stats();
+    res.reallocations = s.reallocations;
+    res.relocated = s.relocated;
+    res.element_moves = element_ops();
+    return res;
+}
+
+bool pathological(cost const &c) {
+    return c.relocated > relocation_bound * c.work + relocation_slack || c.excess_shift != 0;
+}
+
+std::string describe(uint8_t const *data, size_t size) {
+    std::string res;
+    char line[64];
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        op o = static_cast<op>(data[i] % static_cast<uint8_t>(op::count));
+        std::snprintf(line, sizeof line, "%s %u\n", op_name(o), unsigned(data[i + 1]));
+        res += line;
+    }
+    return res;
+}
+
+}
+
+// libFuzzer entry point. A pathological sequence is reported as a crash so
+// libFuzzer saves it, and -minimize_crash=1 shrinks it.
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const *data, size_t size) {
+    instrumented::reset_counts();
+    perf_fuzz::cost c = perf_fuzz::run(data, size);
+    if (perf_fuzz::pathological(c)) {
+        std::fprintf(stderr, "pathological sequence: %zu ops, work %zu, %zu reallocations, "
+                             "%zu relocated, %zu excess shifts\n%s",
+                     c.ops, c.work, c.reallocations, c.relocated, c.excess_shift,
+                     perf_fuzz::describe(data, size).c_str());
+        std::abort();
+    }
+    return 0;
+}
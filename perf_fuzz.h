@@ -0,0 +1,64 @@
+#pragma once
+
+#include "instrumented.h"
+#include "my_deque.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shared by the libFuzzer target and the standalone driver: decodes a byte
+// string into a sequence of my_deque operations, runs it and measures how
+// much element traffic it caused.
+//
+// Every operation is two bytes, an opcode and an argument. Elements an
+// operation creates or destroys are its "work"; relocations done by
+// reallocation must stay within a constant factor of the total work, and
+// insert/erase must only shift the shorter side of the position.
+namespace perf_fuzz {
+
+enum class op : uint8_t {
+    push_back,
+    push_front,
+    pop_back,
+    pop_front,
+    insert,
+    erase,
+    resize,
+    clear,
+    count
+};
+
+char const *op_name(op o);
+
+struct cost {
+    size_t ops = 0;
+    size_t work = 0;
+    size_t reallocations = 0;
+    size_t relocated = 0;
+    size_t element_moves = 0;
+    // moves beyond min(i, n - i) + 1 done by a single insert or erase
+    size_t excess_shift = 0;
+    size_t max_size = 0;
+
+    double relocated_per_work() const {
+        return work ? double(relocated) / work : 0.0;
+    }
+};
+
+// The largest deque a sequence may build; keeps single inputs fast.
+size_t const max_size = 1 << 14;
+
+// Relocations may exceed the work by this factor (plus a small constant
+// for the first few growth steps) before a sequence counts as pathological.
+double const relocation_bound = 4.0;
+size_t const relocation_slack = 16;
+
+cost run(uint8_t const *data, size_t size);
+
+bool pathological(cost const &c);
+
+// one line per operation, for saved sequences and reports
+std::string describe(uint8_t const *data, size_t size);
+
+}
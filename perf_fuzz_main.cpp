@@ -0,0 +1,238 @@
+#include "perf_fuzz.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Standalone driver for builds without libFuzzer.
+//
+//   deque_perf_fuzz [--iterations=N] [--max-ops=N] [--seed=N] [--out=DIR]
+//       random search; pathological sequences are minimized and written to
+//       DIR (default ".") as perf-<hash>.bin with a readable .txt beside it
+//   deque_perf_fuzz FILE...
+//       replays saved sequences and times them, as regression benchmarks
+
+namespace {
+
+using input = std::vector<uint8_t>;
+
+struct options {
+    size_t iterations = 100000;
+    size_t max_ops = 256;
+    uint64_t seed = 1;
+    std::string out_dir = ".";
+    std::vector<std::string> replay;
+};
+
+bool parse_value(char const *arg, char const *name, std::string &value) {
+    size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') {
+        return false;
+    }
+    value = arg + len + 1;
+    return true;
+}
+
+bool parse_options(int argc, char **argv, options &opts) {
+    for (int i = 1; i != argc; ++i) {
+        std::string value;
+        if (parse_value(argv[i], "--iterations", value)) {
+            opts.iterations = std::stoull(value);
+        } else if (parse_value(argv[i], "--max-ops", value)) {
+            opts.max_ops = std::stoull(value);
+        } else if (parse_value(argv[i], "--seed", value)) {
+            opts.seed = std::stoull(value);
+        } else if (parse_value(argv[i], "--out", value)) {
+            opts.out_dir = value;
+        } else if (argv[i][0] == '-') {
+            std::cerr << "unknown option " << argv[i] << '\n';
+            return false;
+        } else {
+            opts.replay.push_back(argv[i]);
+        }
+    }
+    return true;
+}
+
+perf_fuzz::cost measure(input const &in) {
+    instrumented::reset_counts();
+    return perf_fuzz::run(in.data(), in.size());
+}
+
+// Higher is worse; a sequence with mis-shifted elements is worse than any
+// that only relocates too much.
+double badness(perf_fuzz::cost const &c) {
+    return c.relocated_per_work() + 1000.0 * c.excess_shift;
+}
+
+// Drops chunks of operations, largest first, for as long as the sequence
+// stays pathological.
+input minimize(input in) {
+    for (size_t chunk = in.size() / 4 * 2; chunk >= 2; chunk /= 2) {
+        chunk &= ~size_t(1);
+        for (size_t pos = 0; pos + chunk <= in.size();) {
+            input candidate(in.begin(), in.begin() + pos);
+            candidate.insert(candidate.end(), in.begin() + pos + chunk, in.end());
+            if (perf_fuzz::pathological(measure(candidate))) {
+                in.swap(candidate);
+            } else {
+                pos += chunk;
+            }
+        }
+    }
+    return in;
+}
+
+uint64_t hash_input(input const &in) {
+    uint64_t h = 1469598103934665603ull;
+    for (uint8_t b : in) {
+        h ^= b;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void print_cost(std::ostream &out, perf_fuzz::cost const &c) {
+    out << c.ops << " ops, work " << c.work << ", max size " << c.max_size << ", " << c.reallocations
+        << " reallocations, " << c.relocated << " relocated (" << c.relocated_per_work() << " per unit of work), "
+        << c.element_moves << " element moves, " << c.excess_shift << " excess shifts\n";
+}
+
+bool save(options const &opts, input const &in) {
+    char name[32];
+    std::snprintf(name, sizeof name, "perf-%016llx", static_cast<unsigned long long>(hash_input(in)));
+    std::string base = opts.out_dir + "/" + name;
+
+    std::ofstream bin(base + ".bin", std::ios::binary);
+    bin.write(reinterpret_cast<char const *>(in.data()), in.size());
+    std::ofstream txt(base + ".txt");
+    txt << perf_fuzz::describe(in.data(), in.size());
+    if (!bin || !txt) {
+        std::cerr << "failed to write " << base << '\n';
+        return false;
+    }
+    std::cout << "saved " << base << ".bin\n";
+    return true;
+}
+
+input mutate(input in, std::mt19937_64 &rng, size_t max_bytes) {
+    std::uniform_int_distribution<int> byte(0, 255);
+    size_t edits = 1 + rng() % 4;
+    for (size_t e = 0; e != edits; ++e) {
+        switch (rng() % 3) {
+            case 0:
+                if (!in.empty()) {
+                    in[rng() % in.size()] = uint8_t(byte(rng));
+                }
+                break;
+            case 1:
+                if (in.size() + 2 <= max_bytes) {
+                    size_t pos = in.empty() ? 0 : rng() % (in.size() / 2 + 1) * 2;
+                    uint8_t op[2] = {uint8_t(byte(rng)), uint8_t(byte(rng))};
+                    in.insert(in.begin() + std::min(pos, in.size()), op, op + 2);
+                }
+                break;
+            default:
+                if (in.size() >= 2) {
+                    size_t pos = rng() % (in.size() / 2) * 2;
+                    in.erase(in.begin() + pos, in.begin() + pos + 2);
+                }
+                break;
+        }
+    }
+    return in;
+}
+
+int search(options const &opts) {
+    std::mt19937_64 rng(opts.seed);
+    size_t max_bytes = 2 * opts.max_ops;
+
+    input worst;
+    double worst_badness = 0;
+    size_t found = 0;
+
+    for (size_t it = 0; it != opts.iterations; ++it) {
+        input in;
+        if (!worst.empty() && rng() % 2) {
+            in = mutate(worst, rng, max_bytes);
+        } else {
+            in.resize(2 * (1 + rng() % opts.max_ops));
+            for (uint8_t &b : in) {
+                b = uint8_t(rng());
+            }
+        }
+
+        perf_fuzz::cost c = measure(in);
+        double b = badness(c);
+        if (b > worst_badness) {
+            worst_badness = b;
+            worst = in;
+        }
+        if (perf_fuzz::pathological(c)) {
+            input small = minimize(in);
+            std::cout << "pathological sequence after " << it + 1 << " iterations, minimized from "
+                      << in.size() / 2 << " to " << small.size() / 2 << " ops: ";
+            print_cost(std::cout, measure(small));
+            std::cout << perf_fuzz::describe(small.data(), small.size());
+            if (!save(opts, small)) {
+                return 1;
+            }
+            found++;
+            // keep looking for different shapes rather than variations
+            worst.clear();
+            worst_badness = 0;
+        }
+    }
+
+    std::cout << opts.iterations << " sequences, " << found << " pathological\n";
+    if (!worst.empty()) {
+        std::cout << "worst non-pathological: ";
+        print_cost(std::cout, measure(worst));
+    }
+    return found ? 2 : 0;
+}
+
+int replay(options const &opts) {
+    int res = 0;
+    for (std::string const &path : opts.replay) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "failed to read " << path << '\n';
+            return 1;
+        }
+        input in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        perf_fuzz::cost c = measure(in);
+        size_t const reps = 100;
+        auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i != reps; ++i) {
+            perf_fuzz::run(in.data(), in.size());
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+        std::cout << path << ": " << (perf_fuzz::pathological(c) ? "PATHOLOGICAL" : "ok") << ", "
+                  << ns / reps / std::max<size_t>(1, c.ops) << " ns/op, ";
+        print_cost(std::cout, c);
+        if (perf_fuzz::pathological(c)) {
+            res = 2;
+        }
+    }
+    return res;
+}
+
+}
+
+int main(int argc, char **argv) {
+    options opts;
+    if (!parse_options(argc, argv, opts)) {
+        return 1;
+    }
+    return opts.replay.empty() ? search(opts) : replay(opts);
+}
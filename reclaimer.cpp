@@ -0,0 +1,68 @@
+#include "reclaimer.h"
+
+background_reclaimer::background_reclaimer()
+        : thread_(&background_reclaimer::worker, this) {}
+
+background_reclaimer::~background_reclaimer() {
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+background_reclaimer &background_reclaimer::instance() {
+    static background_reclaimer *shared = new background_reclaimer;
+    return *shared;
+}
+
+void background_reclaimer::free_later(void *ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    try {
+        push({&free_, ptr});
+    } catch (...) {
+        operator delete(ptr);
+    }
+}
+
+void background_reclaimer::drain() {
+    std::unique_lock<std::mutex> g(lock_);
+    size_t target = submitted_;
+    done_.wait(g, [&] { return completed_ >= target; });
+}
+
+size_t background_reclaimer::pending() const {
+    std::lock_guard<std::mutex> g(lock_);
+    return submitted_ - completed_;
+}
+
+void background_reclaimer::push(job j) {
+    {
+        std::lock_guard<std::mutex> g(lock_);
+        queue_.push_back(j);
+        submitted_++;
+    }
+    wake_.notify_one();
+}
+
+void background_reclaimer::worker() {
+    std::unique_lock<std::mutex> g(lock_);
+    for (;;) {
+        wake_.wait(g, [&] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;
+        }
+        job j = queue_.front();
+        queue_.pop_front();
+
+        g.unlock();
+        j.run(j.arg);
+        g.lock();
+
+        completed_++;
+        done_.notify_all();
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef EXAM_DEQUE_RECLAIMER_H
+#define EXAM_DEQUE_RECLAIMER_H
+
+#include "my_deque.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Runs element destruction and buffer deallocation on a thread of its own,
+// so that dropping a large deque costs the caller a queue push instead of
+// one destructor call per element.
+class background_reclaimer {
+public:
+    background_reclaimer();
+    background_reclaimer(background_reclaimer const &) = delete;
+    background_reclaimer &operator=(background_reclaimer const &) = delete;
+    // finishes all pending work first
+    ~background_reclaimer();
+
+    // Shared instance used by deque_deferred_storage. It is never destroyed,
+    // so it can take buffers from deques that outlive static destruction.
+    static background_reclaimer &instance();
+
+    // Takes over the contents of c, which is left empty, and destroys them
+    // on the reclaimer thread. C must be nothrow move constructible.
+    template<typename C>
+    void retire(C &&c) {
+        using container = typename std::remove_reference<C>::type;
+        container *moved = new container(std::move(c));
+        try {
+            push({&destroy_<container>, moved});
+        } catch (...) {
+            c = std::move(*moved);
+            delete moved;
+            throw;
+        }
+    }
+
+    // operator delete(ptr) on the reclaimer thread; if the request cannot
+    // be queued the memory is freed right away
+    void free_later(void *ptr) noexcept;
+
+    // blocks until everything queued so far has been reclaimed
+    void drain();
+
+    size_t pending() const;
+
+private:
+    struct job {
+        void (*run)(void *);
+        void *arg;
+    };
+
+    template<typename C>
+    static void destroy_(void *p) {
+        delete static_cast<C *>(p);
+    }
+
+    static void free_(void *p) {
+        operator delete(p);
+    }
+
+    void push(job j);
+    void worker();
+
+    mutable std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    my_deque<job> queue_;
+    size_t submitted_ = 0;
+    size_t completed_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Buffers of at least this size are freed on the reclaimer thread; handing
+// smaller ones over costs more than freeing them.
+size_t const deferred_free_min_bytes = size_t(64) << 10;
+
+// my_deque storage policy whose large buffers are freed by the shared
+// reclaimer, so growth and shrinking never wait for the old buffer to be
+// unmapped. Elements are still destroyed by the deque; use retire() for that.
+struct deque_deferred_storage {
+    static void *allocate(size_t bytes) {
+        return operator new(bytes);
+    }
+
+    static void deallocate(void *ptr, size_t bytes) noexcept {
+        if (bytes >= deferred_free_min_bytes) {
+            background_reclaimer::instance().free_later(ptr);
+        } else {
+            operator delete(ptr);
+        }
+    }
+};
+
+#endif //EXAM_DEQUE_RECLAIMER_H
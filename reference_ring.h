@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// The simplest possible growable ring: power-of-two capacity, masked
+// indexing, relocation by move on growth. It is the lower bound the other
+// containers are compared against.
+template<typename T>
+class reference_ring {
+public:
+    reference_ring() = default;
+
+    reference_ring(size_t size, T const &value) {
+        for (size_t i = 0; i != size; ++i) {
+            push_back(value);
+        }
+    }
+
+    reference_ring(reference_ring const &other) {
+        grow_to(other.capacity_);
+        for (size_t i = 0; i != other.size_; ++i) {
+            new(data_ + i) T(other[i]);
+        }
+        size_ = other.size_;
+    }
+
+    reference_ring &operator=(reference_ring const &) = delete;
+
+    ~reference_ring() {
+        while (size_ != 0) {
+            pop_back();
+        }
+        operator delete(data_);
+    }
+
+    void push_back(T const &value) {
+        if (size_ == capacity_) {
+            grow_to(capacity_ ? 2 * capacity_ : 2);
+        }
+        new(data_ + ((head_ + size_) & (capacity_ - 1))) T(value);
+        size_++;
+    }
+
+    void push_front(T const &value) {
+        if (size_ == capacity_) {
+            grow_to(capacity_ ? 2 * capacity_ : 2);
+        }
+        head_ = (head_ - 1) & (capacity_ - 1);
+        new(data_ + head_) T(value);
+        size_++;
+    }
+
+    void pop_back() {
+        (*this)[size_ - 1].~T();
+        size_--;
+    }
+
+    void pop_front() {
+        data_[head_].~T();
+        head_ = (head_ + 1) & (capacity_ - 1);
+        size_--;
+    }
+
+    T &operator[](size_t i) {
+        return data_[(head_ + i) & (capacity_ - 1)];
+    }
+
+    T const &operator[](size_t i) const {
+        return data_[(head_ + i) & (capacity_ - 1)];
+    }
+
+    T &front() {
+        return (*this)[0];
+    }
+
+    T &back() {
+        return (*this)[size_ - 1];
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    struct const_iterator {
+        reference_ring const *ring;
+        size_t index;
+
+        T const &operator*() const {
+            return (*ring)[index];
+        }
+
+        const_iterator &operator++() {
+            ++index;
+            return *this;
+        }
+
+        bool operator!=(const_iterator const &other) const {
+            return index != other.index;
+        }
+    };
+
+    const_iterator begin() const {
+        return {this, 0};
+    }
+
+    const_iterator end() const {
+        return {this, size_};
+    }
+
+private:
+    void grow_to(size_t new_capacity) {
+        T *new_data = static_cast<T *>(operator new(new_capacity * sizeof(T)));
+        for (size_t i = 0; i != size_; ++i) {
+            new(new_data + i) T(std::move((*this)[i]));
+            (*this)[i].~T();
+        }
+        operator delete(data_);
+        data_ = new_data;
+        capacity_ = new_capacity;
+        head_ = 0;
+    }
+
+    T *data_ = nullptr;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,552 @@
+#ifndef EXAM_DEQUE_SOA_DEQUE_H
+#define EXAM_DEQUE_SOA_DEQUE_H
+
+#include "my_deque.h"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// A deque of rows (Ts...) stored column by column: one buffer holds a ring
+// per field, all sharing head_, size_ and a power-of-two capacity, so row i
+// is slot (head_ + i) & mask in every column. A scan over one field only
+// touches that field's memory; column<I>() hands it out as the same one or
+// two contiguous runs my_deque::spans() returns.
+//
+// Rows are read and written through std::tuple<Ts &...>, which is also
+// what the iterators dereference to. Growth policy and the choice between
+// moving and copying on relocation are those of my_deque.
+template<typename... Ts>
+class soa_deque {
+    static_assert(sizeof...(Ts) > 0, "soa_deque needs at least one column");
+    static_assert(((alignof(Ts) <= alignof(std::max_align_t)) && ...), "columns come from operator new");
+
+public:
+    template<size_t I>
+    using column_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+    using value_type = std::tuple<Ts...>;
+    using reference = std::tuple<Ts &...>;
+    using const_reference = std::tuple<Ts const &...>;
+
+private:
+    template<bool Const>
+    struct row_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef soa_deque::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef typename std::conditional<Const, soa_deque::const_reference, soa_deque::reference>::type reference;
+
+        friend class soa_deque;
+
+    private:
+        using owner_pointer = typename std::conditional<Const, soa_deque const *, soa_deque *>::type;
+
+        row_iterator(owner_pointer owner, size_t pos) : owner_(owner), pos(pos) {}
+
+    public:
+        row_iterator() : owner_(nullptr), pos(0) {}
+
+        template<bool C, typename = typename std::enable_if<Const && !C>::type>
+        row_iterator(row_iterator<C> const &other) : owner_(other.owner_), pos(other.pos) {}
+
+        reference operator*() const {
+            return (*owner_)[pos];
+        }
+
+        reference operator[](difference_type diff) const {
+            return (*owner_)[pos + diff];
+        }
+
+        row_iterator &operator++() {
+            pos++;
+            return *this;
+        }
+
+        row_iterator operator++(int) {
+            auto res = *this;
+            ++(*this);
+            return res;
+        }
+
+        row_iterator &operator--() {
+            pos--;
+            return *this;
+        }
+
+        row_iterator operator--(int) {
+            auto res = *this;
+            --(*this);
+            return res;
+        }
+
+        row_iterator &operator+=(difference_type diff) {
+            pos += diff;
+            return *this;
+        }
+
+        row_iterator &operator-=(difference_type diff) {
+            pos -= diff;
+            return *this;
+        }
+
+        friend row_iterator operator+(row_iterator it, difference_type diff) {
+            return it += diff;
+        }
+
+        friend row_iterator operator-(row_iterator it, difference_type diff) {
+            return it -= diff;
+        }
+
+        friend difference_type operator-(row_iterator const &a, row_iterator const &b) {
+            return difference_type(a.pos - b.pos);
+        }
+
+        friend bool operator<(row_iterator const &a, row_iterator const &b) {
+            return a.pos < b.pos;
+        }
+
+        friend bool operator<=(row_iterator const &a, row_iterator const &b) {
+            return a.pos <= b.pos;
+        }
+
+        friend bool operator>(row_iterator const &a, row_iterator const &b) {
+            return a.pos > b.pos;
+        }
+
+        friend bool operator>=(row_iterator const &a, row_iterator const &b) {
+            return a.pos >= b.pos;
+        }
+
+        friend bool operator==(row_iterator const &a, row_iterator const &b) {
+            return a.pos == b.pos && a.owner_ == b.owner_;
+        }
+
+        friend bool operator!=(row_iterator const &a, row_iterator const &b) {
+            return !(a == b);
+        }
+
+    private:
+        template<bool C>
+        friend struct row_iterator;
+
+        owner_pointer owner_;
+        size_t pos;
+    };
+
+public:
+    using iterator = row_iterator<false>;
+    using const_iterator = row_iterator<true>;
+
+    soa_deque() noexcept;
+    soa_deque(soa_deque const &other);
+    soa_deque(soa_deque &&other) noexcept;
+    soa_deque &operator=(soa_deque const &other);
+    soa_deque &operator=(soa_deque &&other) noexcept;
+    ~soa_deque();
+
+    void reserve(size_t new_capacity);
+    void shrink_to_fit();
+
+    void push_back(Ts const &... values);
+    void push_front(Ts const &... values);
+    void pop_back();
+    void pop_front();
+
+    reference front() noexcept;
+    const_reference front() const noexcept;
+    reference back() noexcept;
+    const_reference back() const noexcept;
+    reference operator[](size_t index) noexcept;
+    const_reference operator[](size_t index) const noexcept;
+
+    // field I of every row, in row order
+    template<size_t I>
+    deque_spans<column_type<I>> column() noexcept;
+    template<size_t I>
+    deque_spans<column_type<I> const> column() const noexcept;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+    size_t capacity() const noexcept;
+    void clear() noexcept;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    template<typename... Us>
+    friend void swap(soa_deque<Us...> &a, soa_deque<Us...> &b) noexcept;
+
+private:
+    using indices = std::index_sequence_for<Ts...>;
+
+    // Columns follow each other in one buffer, each aligned for its type:
+    // column I starts at column_offset_<I>(capacity).
+    template<size_t I>
+    static size_t column_offset_(size_t capacity) noexcept {
+        size_t const sizes[] = {sizeof(Ts)...};
+        size_t const aligns[] = {alignof(Ts)...};
+        size_t offset = 0;
+        for (size_t k = 0; k != I; ++k) {
+            offset += sizes[k] * capacity;
+            offset = (offset + aligns[k + 1] - 1) / aligns[k + 1] * aligns[k + 1];
+        }
+        return offset;
+    }
+
+    static size_t buffer_bytes_(size_t capacity) noexcept {
+        size_t const last = sizeof...(Ts) - 1;
+        return column_offset_<last>(capacity) + sizeof(column_type<last>) * capacity;
+    }
+
+    template<size_t I>
+    static column_type<I> *column_data_(unsigned char *buffer, size_t capacity) noexcept {
+        return reinterpret_cast<column_type<I> *>(buffer + column_offset_<I>(capacity));
+    }
+
+    template<size_t I>
+    column_type<I> &cell_(size_t slot) const noexcept {
+        return column_data_<I>(data_, capacity())[slot];
+    }
+
+    template<size_t... I>
+    reference row_(size_t slot, std::index_sequence<I...>) const noexcept {
+        return reference(cell_<I>(slot)...);
+    }
+
+    // constructs a row in slot; if a field throws, the ones before it are
+    // destroyed again
+    template<size_t... I>
+    void construct_(size_t slot, std::index_sequence<I...>, Ts const &... values) {
+        size_t built = 0;
+        try {
+            ((new(&cell_<I>(slot)) column_type<I>(values), ++built), ...);
+        } catch (...) {
+            ((I < built ? std::destroy_at(&cell_<I>(slot)) : void()), ...);
+            throw;
+        }
+    }
+
+    template<size_t... I>
+    void destroy_(size_t slot, std::index_sequence<I...>) noexcept {
+        (std::destroy_at(&cell_<I>(slot)), ...);
+    }
+
+    // Moving one column and then failing to copy the next would lose the
+    // moved rows, so columns are only moved when none of them can throw.
+    static constexpr bool move_on_relocate_ = (std::is_nothrow_move_constructible<Ts>::value && ...);
+
+    // copies the rows of from into to[0, size); nothing is left
+    // constructed if a copy throws
+    template<typename U>
+    static void copy_column_(deque_spans<U const> from, U *to);
+    template<size_t... I>
+    void copy_columns_(soa_deque const &other, std::index_sequence<I...>);
+
+    template<size_t I>
+    void relocate_column_(unsigned char *dest, size_t dest_capacity);
+    template<size_t... I>
+    void relocate_(unsigned char *dest, size_t dest_capacity, std::index_sequence<I...>);
+
+    void fix_capacity() {
+        size_t cap = capacity();
+        if (size_ >= cap) {
+            reserve(std::max(size_t(2), 2 * cap));
+        } else if (size_ <= cap / 4) {
+            reserve(cap / 2);
+        }
+    }
+
+    size_t mask_() const noexcept {
+        return capacity() - 1;
+    }
+
+    size_t slot_(size_t index) const noexcept {
+        return (head_ + index) & mask_();
+    }
+
+    unsigned char *data_;
+    size_t head_;
+    size_t size_ : 58;
+    size_t log_capacity_ : 6;
+};
+
+template<typename... Ts>
+soa_deque<Ts...>::soa_deque() noexcept
+        : data_(nullptr),
+          head_(0),
+          size_(0),
+          log_capacity_(0) {}
+
+template<typename... Ts>
+soa_deque<Ts...>::soa_deque(soa_deque const &other) : soa_deque() {
+    if (other.size_ == 0) {
+        return;
+    }
+    reserve(other.capacity());
+    copy_columns_(other, indices());
+    size_ = other.size_;
+}
+
+template<typename... Ts>
+soa_deque<Ts...>::soa_deque(soa_deque &&other) noexcept : soa_deque() {
+    swap(*this, other);
+}
+
+template<typename... Ts>
+soa_deque<Ts...> &soa_deque<Ts...>::operator=(soa_deque const &other) {
+    soa_deque tmp(other);
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename... Ts>
+soa_deque<Ts...> &soa_deque<Ts...>::operator=(soa_deque &&other) noexcept {
+    soa_deque tmp(std::move(other));
+    swap(tmp, *this);
+    return *this;
+}
+
+template<typename... Ts>
+soa_deque<Ts...>::~soa_deque() {
+    clear();
+    if (data_ != nullptr) {
+        operator delete(data_);
+    }
+}
+
+template<typename... Ts>
+template<typename U>
+void soa_deque<Ts...>::copy_column_(deque_spans<U const> from, U *to) {
+    U *mid = std::uninitialized_copy(from.first.begin(), from.first.end(), to);
+    try {
+        std::uninitialized_copy(from.second.begin(), from.second.end(), mid);
+    } catch (...) {
+        std::destroy(to, mid);
+        throw;
+    }
+}
+
+template<typename... Ts>
+template<size_t... I>
+void soa_deque<Ts...>::copy_columns_(soa_deque const &other, std::index_sequence<I...>) {
+    size_t done = 0;
+    try {
+        ((copy_column_(other.template column<I>(), column_data_<I>(data_, capacity())), ++done), ...);
+    } catch (...) {
+        ((I < done ? (void) std::destroy_n(column_data_<I>(data_, capacity()), other.size_) : void()), ...);
+        throw;
+    }
+}
+
+template<typename... Ts>
+template<size_t I>
+void soa_deque<Ts...>::relocate_column_(unsigned char *dest, size_t dest_capacity) {
+    using U = column_type<I>;
+    U *to = column_data_<I>(dest, dest_capacity);
+    if constexpr (move_on_relocate_ || !std::is_copy_constructible<U>::value) {
+        deque_spans<U> from = column<I>();
+        to = std::uninitialized_move(from.first.begin(), from.first.end(), to);
+        std::uninitialized_move(from.second.begin(), from.second.end(), to);
+    } else {
+        copy_column_(static_cast<soa_deque const *>(this)->template column<I>(), to);
+    }
+}
+
+template<typename... Ts>
+template<size_t... I>
+void soa_deque<Ts...>::relocate_(unsigned char *dest, size_t dest_capacity, std::index_sequence<I...>) {
+    size_t done = 0;
+    try {
+        ((relocate_column_<I>(dest, dest_capacity), ++done), ...);
+    } catch (...) {
+        ((I < done ? (void) std::destroy_n(column_data_<I>(dest, dest_capacity), size_) : void()), ...);
+        throw;
+    }
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::reserve(size_t new_capacity) {
+    new_capacity = std::max<size_t>(new_capacity, size_);
+    if (new_capacity == 0) {
+        return;
+    }
+    size_t log_capacity = 0;
+    while ((size_t(1) << log_capacity) < new_capacity) {
+        log_capacity++;
+    }
+    new_capacity = size_t(1) << log_capacity;
+
+    std::unique_ptr<unsigned char, void (*)(void *)> new_data(
+            static_cast<unsigned char *>(operator new(buffer_bytes_(new_capacity))),
+            [](void *ptr) { operator delete(ptr); });
+    if (data_ != nullptr) {
+        relocate_(new_data.get(), new_capacity, indices());
+        for (size_t i = 0; i != size_; ++i) {
+            destroy_(slot_(i), indices());
+        }
+        operator delete(data_);
+    }
+    data_ = new_data.release();
+    head_ = 0;
+    log_capacity_ = log_capacity;
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::shrink_to_fit() {
+    if (size_ != 0) {
+        if (capacity() / 2 >= size_) {
+            reserve(size_);
+        }
+        return;
+    }
+    if (data_ != nullptr) {
+        operator delete(data_);
+        data_ = nullptr;
+        head_ = 0;
+        log_capacity_ = 0;
+    }
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::push_back(Ts const &... values) {
+    fix_capacity();
+    construct_(slot_(size_), indices(), values...);
+    size_++;
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::push_front(Ts const &... values) {
+    fix_capacity();
+    size_t slot = (head_ - 1) & mask_();
+    construct_(slot, indices(), values...);
+    head_ = slot;
+    size_++;
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::pop_back() {
+    destroy_(slot_(size_ - 1), indices());
+    size_--;
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::pop_front() {
+    destroy_(slot_(0), indices());
+    size_--;
+    head_ = (head_ + 1) & mask_();
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::reference soa_deque<Ts...>::front() noexcept {
+    return row_(slot_(0), indices());
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::const_reference soa_deque<Ts...>::front() const noexcept {
+    return row_(slot_(0), indices());
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::reference soa_deque<Ts...>::back() noexcept {
+    return row_(slot_(size_ - 1), indices());
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::const_reference soa_deque<Ts...>::back() const noexcept {
+    return row_(slot_(size_ - 1), indices());
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::reference soa_deque<Ts...>::operator[](size_t index) noexcept {
+    return row_(slot_(index), indices());
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::const_reference soa_deque<Ts...>::operator[](size_t index) const noexcept {
+    return row_(slot_(index), indices());
+}
+
+template<typename... Ts>
+template<size_t I>
+deque_spans<typename soa_deque<Ts...>::template column_type<I>> soa_deque<Ts...>::column() noexcept {
+    deque_spans<column_type<I>> res;
+    if (data_ != nullptr) {
+        column_type<I> *data = column_data_<I>(data_, capacity());
+        size_t first = std::min<size_t>(size_, capacity() - head_);
+        res.first = {data + head_, first};
+        res.second = {data, size_ - first};
+    }
+    return res;
+}
+
+template<typename... Ts>
+template<size_t I>
+deque_spans<typename soa_deque<Ts...>::template column_type<I> const> soa_deque<Ts...>::column() const noexcept {
+    deque_spans<column_type<I>> res = const_cast<soa_deque *>(this)->template column<I>();
+    return {{res.first.data, res.first.size}, {res.second.data, res.second.size}};
+}
+
+template<typename... Ts>
+bool soa_deque<Ts...>::empty() const noexcept {
+    return size_ == 0;
+}
+
+template<typename... Ts>
+size_t soa_deque<Ts...>::size() const noexcept {
+    return size_;
+}
+
+template<typename... Ts>
+size_t soa_deque<Ts...>::capacity() const noexcept {
+    return data_ ? size_t(1) << log_capacity_ : 0;
+}
+
+template<typename... Ts>
+void soa_deque<Ts...>::clear() noexcept {
+    while (size_ != 0) {
+        pop_back();
+    }
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::iterator soa_deque<Ts...>::begin() {
+    return iterator(this, 0);
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::iterator soa_deque<Ts...>::end() {
+    return iterator(this, size_);
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::const_iterator soa_deque<Ts...>::begin() const {
+    return const_iterator(this, 0);
+}
+
+template<typename... Ts>
+typename soa_deque<Ts...>::const_iterator soa_deque<Ts...>::end() const {
+    return const_iterator(this, size_);
+}
+
+template<typename... Us>
+void swap(soa_deque<Us...> &a, soa_deque<Us...> &b) noexcept {
+    std::swap(a.data_, b.data_);
+    std::swap(a.head_, b.head_);
+    size_t size = a.size_;
+    a.size_ = b.size_;
+    b.size_ = size;
+    size_t log_capacity = a.log_capacity_;
+    a.log_capacity_ = b.log_capacity_;
+    b.log_capacity_ = log_capacity;
+}
+
+#endif //EXAM_DEQUE_SOA_DEQUE_H
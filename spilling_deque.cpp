@@ -0,0 +1,92 @@
+#include "spilling_deque.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    [[noreturn]] void throw_errno(char const *what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+}
+
+spill_file::spill_file(std::string const &dir) {
+    std::string path = dir + "/deque-spill-XXXXXX";
+    fd_ = mkstemp(&path[0]);
+    if (fd_ < 0) {
+        throw_errno("cannot create spill file");
+    }
+    // the file goes away with the descriptor, even after a crash
+    unlink(path.c_str());
+}
+
+spill_file::~spill_file() {
+    close(fd_);
+}
+
+uint64_t spill_file::append(void const *data, size_t bytes) {
+    uint64_t offset = end_;
+    char const *p = static_cast<char const *>(data);
+    while (bytes != 0) {
+        ssize_t written = pwrite(fd_, p, bytes, off_t(end_));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("cannot write spill file");
+        }
+        p += written;
+        bytes -= size_t(written);
+        end_ += uint64_t(written);
+    }
+    // start writeback now so the dirty pages do not pile up in memory
+    sync_file_range(fd_, off_t(offset), off_t(end_ - offset), SYNC_FILE_RANGE_WRITE);
+    return offset;
+}
+
+void spill_file::read(uint64_t offset, void *data, size_t bytes) {
+    char *p = static_cast<char *>(data);
+    while (bytes != 0) {
+        ssize_t got = pread(fd_, p, bytes, off_t(offset));
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_errno("cannot read spill file");
+        }
+        if (got == 0) {
+            throw std::system_error(EIO, std::generic_category(), "spill file is truncated");
+        }
+        p += got;
+        bytes -= size_t(got);
+        offset += uint64_t(got);
+    }
+}
+
+void spill_file::will_need(uint64_t offset, size_t bytes) noexcept {
+    posix_fadvise(fd_, off_t(offset), off_t(bytes), POSIX_FADV_WILLNEED);
+}
+
+void spill_file::release(uint64_t offset, size_t bytes) noexcept {
+    posix_fadvise(fd_, off_t(offset), off_t(bytes), POSIX_FADV_DONTNEED);
+    // the newest range can be cut off on any filesystem, and the next
+    // append reuses its offsets
+    if (offset + bytes == end_ && ftruncate(fd_, off_t(offset)) == 0) {
+        end_ = offset;
+        return;
+    }
+    // anything else only frees space early; once the filesystem refuses,
+    // the blocks stay until reset() and the call is not retried
+    if (punch_holes_ && fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(bytes)) != 0 &&
+        (errno == EOPNOTSUPP || errno == ENOSYS)) {
+        punch_holes_ = false;
+    }
+}
+
+void spill_file::reset() noexcept {
+    if (ftruncate(fd_, 0) == 0) {
+        end_ = 0;
+    }
+}
@@ -0,0 +1,325 @@
+#ifndef EXAM_DEQUE_SPILLING_DEQUE_H
+#define EXAM_DEQUE_SPILLING_DEQUE_H
+
+#include "my_deque.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Unlinked temporary file that spilled segments are written to. Consumed
+// ranges are punched out, or cut off when they end the file, and the file
+// starts over once it holds nothing. On a filesystem without hole punching,
+// space in the middle of the file only comes back at that reset.
+class spill_file {
+public:
+    explicit spill_file(std::string const &dir);
+    spill_file(spill_file const &) = delete;
+    spill_file &operator=(spill_file const &) = delete;
+    ~spill_file();
+
+    // appends bytes and returns the offset they were written at
+    uint64_t append(void const *data, size_t bytes);
+    void read(uint64_t offset, void *data, size_t bytes);
+
+    // hints for ranges that will be read soon, or were read and are done
+    void will_need(uint64_t offset, size_t bytes) noexcept;
+    void release(uint64_t offset, size_t bytes) noexcept;
+    void reset() noexcept;
+
+private:
+    int fd_;
+    uint64_t end_ = 0;
+    // cleared once the filesystem turns hole punching down
+    bool punch_holes_ = true;
+};
+
+struct spilling_deque_stats {
+    size_t spilled_segments = 0;
+    size_t loaded_segments = 0;
+    size_t bytes_written = 0;
+    size_t bytes_read = 0;
+    size_t readahead_requests = 0;
+};
+
+// A deque for trivially copyable T whose memory stays bounded however long
+// it gets: elements near the front and back live in two my_deque rings,
+// and once the rings hold more than memory_limit bytes, the segment_bytes
+// of the pushed-to ring nearest the middle go to a temporary file in one
+// write. The middle is therefore a sequence of file segments, read back
+// whole when either end runs dry, with readahead requested half a segment
+// early.
+template<typename T>
+class spilling_deque {
+    static_assert(std::is_trivially_copyable<T>::value, "spilled elements are written to disk as bytes");
+
+public:
+    explicit spilling_deque(size_t memory_limit = size_t(64) << 20, size_t segment_bytes = size_t(1) << 20,
+                            std::string const &dir = default_spill_dir());
+    spilling_deque(spilling_deque const &) = delete;
+    spilling_deque &operator=(spilling_deque const &) = delete;
+
+    void push_back(T const &value);
+    void push_front(T const &value);
+    void pop_back();
+    void pop_front();
+
+    // may read a segment back from disk
+    T &front();
+    T &back();
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    size_t in_memory() const noexcept;
+    size_t spilled() const noexcept;
+    spilling_deque_stats stats() const noexcept;
+
+    static std::string default_spill_dir();
+
+private:
+    struct segment {
+        uint64_t offset;
+        size_t count;
+    };
+
+    void spill_if_needed_(bool at_front);
+    void spill_(bool at_front);
+    void refill_front_();
+    void refill_back_();
+    void load_(segment s, bool at_front);
+    void prefetch_front_() noexcept;
+    void prefetch_back_() noexcept;
+
+    size_t segment_elems_;
+    size_t memory_limit_elems_;
+    my_deque<T> head_;
+    my_deque<segment> segments_;
+    my_deque<T> tail_;
+    size_t spilled_ = 0;
+    spill_file file_;
+    std::vector<T> io_buffer_;
+    // offsets of the segments readahead was last requested for, at each end
+    uint64_t prefetched_front_ = UINT64_MAX;
+    uint64_t prefetched_back_ = UINT64_MAX;
+    spilling_deque_stats stats_;
+};
+
+template<typename T>
+spilling_deque<T>::spilling_deque(size_t memory_limit, size_t segment_bytes, std::string const &dir)
+        : segment_elems_(std::max<size_t>(1, segment_bytes / sizeof(T))),
+          memory_limit_elems_(std::max<size_t>(2 * segment_elems_, memory_limit / sizeof(T))),
+          file_(dir) {}
+
+template<typename T>
+std::string spilling_deque<T>::default_spill_dir() {
+    char const *dir = std::getenv("TMPDIR");
+    return dir && *dir ? dir : "/tmp";
+}
+
+template<typename T>
+void spilling_deque<T>::push_back(T const &value) {
+    tail_.push_back(value);
+    spill_if_needed_(false);
+}
+
+template<typename T>
+void spilling_deque<T>::push_front(T const &value) {
+    head_.push_front(value);
+    spill_if_needed_(true);
+}
+
+template<typename T>
+void spilling_deque<T>::pop_front() {
+    refill_front_();
+    head_.pop_front();
+    prefetch_front_();
+}
+
+template<typename T>
+void spilling_deque<T>::pop_back() {
+    refill_back_();
+    tail_.pop_back();
+    prefetch_back_();
+}
+
+template<typename T>
+T &spilling_deque<T>::front() {
+    refill_front_();
+    return head_.front();
+}
+
+template<typename T>
+T &spilling_deque<T>::back() {
+    refill_back_();
+    return tail_.back();
+}
+
+template<typename T>
+size_t spilling_deque<T>::size() const noexcept {
+    return head_.size() + spilled_ + tail_.size();
+}
+
+template<typename T>
+bool spilling_deque<T>::empty() const noexcept {
+    return size() == 0;
+}
+
+template<typename T>
+size_t spilling_deque<T>::in_memory() const noexcept {
+    return head_.size() + tail_.size();
+}
+
+template<typename T>
+size_t spilling_deque<T>::spilled() const noexcept {
+    return spilled_;
+}
+
+template<typename T>
+spilling_deque_stats spilling_deque<T>::stats() const noexcept {
+    return stats_;
+}
+
+template<typename T>
+void spilling_deque<T>::spill_if_needed_(bool at_front) {
+    if (in_memory() <= memory_limit_elems_) {
+        return;
+    }
+    // spill from the ring that grew, unless it is too short for a segment
+    if ((at_front ? head_ : tail_).size() >= segment_elems_) {
+        spill_(at_front);
+    } else if ((at_front ? tail_ : head_).size() >= segment_elems_) {
+        spill_(!at_front);
+    }
+}
+
+template<typename T>
+void spilling_deque<T>::spill_(bool at_front) {
+    my_deque<T> &ring = at_front ? head_ : tail_;
+    my_deque<T> &other = at_front ? tail_ : head_;
+    if (segments_.empty() && other.size() < segment_elems_) {
+        // nothing is spilled yet, so the elements of ring nearest the middle
+        // are next to the other ring; keep them in memory there instead
+        while (other.size() < segment_elems_ && !ring.empty()) {
+            if (at_front) {
+                tail_.push_front(head_.back());
+                head_.pop_back();
+            } else {
+                head_.push_back(tail_.front());
+                tail_.pop_front();
+            }
+        }
+        return;
+    }
+
+    // the segment is the back of the front ring, or the front of the back one
+    size_t first = at_front ? ring.size() - segment_elems_ : 0;
+    io_buffer_.resize(segment_elems_);
+    for (size_t i = 0; i != segment_elems_; ++i) {
+        io_buffer_[i] = ring[first + i];
+    }
+    uint64_t offset = file_.append(io_buffer_.data(), segment_elems_ * sizeof(T));
+    if (at_front) {
+        segments_.push_front(segment{offset, segment_elems_});
+    } else {
+        segments_.push_back(segment{offset, segment_elems_});
+    }
+    for (size_t i = 0; i != segment_elems_; ++i) {
+        if (at_front) {
+            head_.pop_back();
+        } else {
+            tail_.pop_front();
+        }
+    }
+    spilled_ += segment_elems_;
+    stats_.spilled_segments++;
+    stats_.bytes_written += segment_elems_ * sizeof(T);
+}
+
+template<typename T>
+void spilling_deque<T>::refill_front_() {
+    if (!head_.empty()) {
+        return;
+    }
+    if (!segments_.empty()) {
+        segment s = segments_.front();
+        load_(s, true);
+        segments_.pop_front();
+        return;
+    }
+    // nothing on disk: the front is the oldest element of the back ring
+    head_.push_back(tail_.front());
+    tail_.pop_front();
+}
+
+template<typename T>
+void spilling_deque<T>::refill_back_() {
+    if (!tail_.empty()) {
+        return;
+    }
+    if (!segments_.empty()) {
+        segment s = segments_.back();
+        load_(s, false);
+        segments_.pop_back();
+        return;
+    }
+    tail_.push_front(head_.back());
+    head_.pop_back();
+}
+
+template<typename T>
+void spilling_deque<T>::load_(segment s, bool at_front) {
+    io_buffer_.resize(s.count);
+    file_.read(s.offset, io_buffer_.data(), s.count * sizeof(T));
+    my_deque<T> &ring = at_front ? head_ : tail_;
+    for (size_t i = 0; i != s.count; ++i) {
+        ring.push_back(io_buffer_[i]);
+    }
+    file_.release(s.offset, s.count * sizeof(T));
+    // the offsets may be reused by the next spill
+    if (prefetched_front_ == s.offset) {
+        prefetched_front_ = UINT64_MAX;
+    }
+    if (prefetched_back_ == s.offset) {
+        prefetched_back_ = UINT64_MAX;
+    }
+    spilled_ -= s.count;
+    stats_.loaded_segments++;
+    stats_.bytes_read += s.count * sizeof(T);
+    if (spilled_ == 0) {
+        file_.reset();
+    }
+}
+
+template<typename T>
+void spilling_deque<T>::prefetch_front_() noexcept {
+    if (segments_.empty() || head_.size() > segment_elems_ / 2) {
+        return;
+    }
+    segment const &next = segments_.front();
+    if (next.offset != prefetched_front_) {
+        file_.will_need(next.offset, next.count * sizeof(T));
+        prefetched_front_ = next.offset;
+        stats_.readahead_requests++;
+    }
+}
+
+template<typename T>
+void spilling_deque<T>::prefetch_back_() noexcept {
+    if (segments_.empty() || tail_.size() > segment_elems_ / 2) {
+        return;
+    }
+    segment const &next = segments_.back();
+    if (next.offset != prefetched_back_) {
+        file_.will_need(next.offset, next.count * sizeof(T));
+        prefetched_back_ = next.offset;
+        stats_.readahead_requests++;
+    }
+}
+
+#endif //EXAM_DEQUE_SPILLING_DEQUE_H
@@ -1,8 +1,33 @@
 #include <gtest/gtest.h>
 
+#include "alloc_profiler.h"
+#include "buffer_cache.h"
 #include "fault_injection.h"
+#include "compressed_deque.h"
 #include "counted.h"
 #include "my_deque.h"
+#include "numa_storage.h"
+#include "reclaimer.h"
+#include "soa_deque.h"
+#include "spilling_deque.h"
+#include "timed_deque.h"
+#include "timer_wheel.h"
+#include "window_aggregator.h"
+#include "incremental_deque.h"
+#include "instrumented.h"
+#include "memory_budget.h"
+#include "multires_ring.h"
+#include "perf_fuzz.h"
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <set>
+#include <thread>
 
 using container = my_deque<counted>;
 
@@ -644,3 +669,1469 @@ TEST(fault_injection, erase)
         expect_eq(c, {6, 3, 8, 2, 7, 10});
     });
 }
+
+TEST(stats, disabled_by_default)
+{
+    my_deque<int> c;
+    c.push_back(1);
+    c.pop_back();
+    EXPECT_FALSE(my_deque<int>::enabled);
+    EXPECT_EQ(0u, c.stats().push_back);
+    EXPECT_EQ(0u, c.stats().reallocations);
+}
+
+TEST(stats, push_pop_counts)
+{
+    my_deque<int, deque_stats_enabled> c;
+    mass_push_back(c, {1, 2, 3});
+    mass_push_front(c, {4, 5});
+    c.pop_back();
+    c.pop_front();
+    c.pop_front();
+
+    my_deque_stats s = c.stats();
+    EXPECT_EQ(3u, s.push_back);
+    EXPECT_EQ(2u, s.push_front);
+    EXPECT_EQ(1u, s.pop_back);
+    EXPECT_EQ(2u, s.pop_front);
+    EXPECT_EQ(5u, s.peak_size);
+}
+
+TEST(stats, consume_front_counts_each_element)
+{
+    my_deque<int, deque_stats_enabled> c;
+    for (int i = 0; i != 10; ++i)
+        c.push_back(i);
+    c.pop_front();
+    c.consume_front(6);
+    c.consume_front(0);
+
+    EXPECT_EQ(7u, c.stats().pop_front);
+    ASSERT_EQ(3u, c.size());
+    EXPECT_EQ(7, c.front());
+}
+
+TEST(stats, reallocations)
+{
+    my_deque<int, deque_stats_enabled> c;
+    for (int i = 0; i != 8; ++i)
+        c.push_back(i);
+
+    // capacity goes 2 -> 4 -> 8, the last push that fills the ring does not grow it
+    my_deque_stats s = c.stats();
+    EXPECT_EQ(3u, s.reallocations);
+    EXPECT_EQ(0u + 2u + 4u, s.relocated);
+    EXPECT_EQ((2u + 4u + 8u) * sizeof(int), s.bytes_allocated);
+    EXPECT_EQ((2u + 4u) * sizeof(int), s.bytes_freed);
+    EXPECT_EQ(8u, s.peak_capacity);
+
+    c.reset_stats();
+    EXPECT_EQ(0u, c.stats().reallocations);
+}
+
+TEST(stats, resize_grows_geometrically)
+{
+    my_deque<int, deque_stats_enabled> c(3, 7);
+    expect_eq(c, {7, 7, 7});
+
+    for (size_t n = 4; n != 1000; ++n)
+        c.resize(n, 7);
+
+    my_deque_stats s = c.stats();
+    EXPECT_EQ(999u, c.size());
+    EXPECT_LE(s.reallocations, 10u);
+    EXPECT_LE(s.relocated, 2 * c.size());
+}
+
+TEST(stats, compact_header)
+{
+    static_assert(sizeof(my_deque<int>) == 3 * sizeof(void*), "my_deque header is pointer, head and size");
+    static_assert(sizeof(my_deque<counted>) == 3 * sizeof(void*), "my_deque header is pointer, head and size");
+
+    my_deque<int> c;
+    EXPECT_EQ(0u, c.capacity());
+    c.reserve(5);
+    EXPECT_EQ(8u, c.capacity());
+    mass_push_back(c, {1, 2, 3, 4, 5, 6, 7, 8});
+    EXPECT_EQ(8u, c.capacity());
+    c.push_front(0);
+    EXPECT_EQ(16u, c.capacity());
+    expect_eq(c, {0, 1, 2, 3, 4, 5, 6, 7, 8});
+}
+
+TEST(stats, memory_usage)
+{
+    my_deque<int> c;
+    EXPECT_EQ(0u, c.memory_usage().payload_bytes);
+    EXPECT_EQ(0u, c.memory_usage().slack_bytes);
+
+    mass_push_back(c, {1, 2, 3, 4, 5});
+    my_deque_memory m = c.memory_usage();
+    EXPECT_EQ(5 * sizeof(int), m.payload_bytes);
+    EXPECT_EQ((c.capacity() - 5) * sizeof(int), m.slack_bytes);
+    EXPECT_EQ(sizeof(c), m.header_bytes);
+    EXPECT_EQ(c.capacity() * sizeof(int) + sizeof(c), m.total_bytes());
+}
+
+TEST(incremental, matches_std_deque)
+{
+    incremental_deque<int> c;
+    std::deque<int> expected;
+    std::mt19937 rng(7);
+
+    for (int i = 0; i != 20000; ++i)
+    {
+        unsigned op = rng() % 8;
+        if (op < 3 || expected.empty())
+        {
+            c.push_back(i);
+            expected.push_back(i);
+        }
+        else if (op < 5)
+        {
+            c.push_front(i);
+            expected.push_front(i);
+        }
+        else if (op < 7)
+        {
+            c.pop_front();
+            expected.pop_front();
+        }
+        else
+        {
+            c.pop_back();
+            expected.pop_back();
+        }
+
+        ASSERT_EQ(expected.size(), c.size());
+        if (!expected.empty())
+        {
+            ASSERT_EQ(expected.front(), c.front());
+            ASSERT_EQ(expected.back(), c.back());
+            size_t k = rng() % expected.size();
+            ASSERT_EQ(expected[k], c[k]);
+        }
+    }
+    EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+}
+
+TEST(incremental, migration_is_bounded)
+{
+    incremental_deque<int> c;
+    for (int i = 0; i != 8; ++i)
+        c.push_back(i);
+    EXPECT_EQ(8u, c.capacity());
+    EXPECT_FALSE(c.migrating());
+
+    c.push_back(8);
+    EXPECT_EQ(16u, c.capacity());
+    EXPECT_TRUE(c.migrating());
+
+    for (int i = 0; i != 9; ++i)
+        EXPECT_EQ(i, c[i]);
+
+    // two elements move on each of the next pushes
+    for (int i = 9; i != 12; ++i)
+        c.push_back(i);
+    EXPECT_TRUE(c.migrating());
+    c.push_back(12);
+    EXPECT_FALSE(c.migrating());
+    for (int i = 0; i != 13; ++i)
+        EXPECT_EQ(i, c[i]);
+}
+
+TEST(incremental, pops_during_migration)
+{
+    counted::no_new_instances_guard g;
+
+    incremental_deque<counted> c;
+    for (int i = 0; i != 33; ++i)
+        c.push_back(i);
+    EXPECT_TRUE(c.migrating());
+    c.pop_front();
+    c.pop_back();
+    c.push_front(-1);
+    EXPECT_EQ(-1, c.front());
+    EXPECT_EQ(31, c.back());
+    EXPECT_EQ(1, c[1]);
+
+    incremental_deque<counted> c2 = c;
+    EXPECT_TRUE(std::equal(c.begin(), c.end(), c2.begin(), c2.end()));
+    c.clear();
+    EXPECT_TRUE(c.empty());
+}
+
+TEST(fault_injection, incremental_push_back)
+{
+    faulty_run([]
+    {
+        incremental_deque<counted> c;
+        for (int i = 0; i != 8; ++i)
+            c.push_back(i);
+
+        try
+        {
+            c.push_back(8);
+        }
+        catch (...)
+        {
+            fault_injection_disable dg;
+            expect_eq(c, {0, 1, 2, 3, 4, 5, 6, 7});
+            throw;
+        }
+
+        fault_injection_disable dg;
+        expect_eq(c, {0, 1, 2, 3, 4, 5, 6, 7, 8});
+    });
+}
+
+// Swallows the faults of individual push_backs and only reports them at the
+// end, so the explored sequences inject several faults per run.
+void retrying_workload(std::atomic<size_t>& runs)
+{
+    runs.fetch_add(1, std::memory_order_relaxed);
+
+    my_deque<int> c;
+    std::vector<int> expected;
+    bool failed = false;
+    for (int i = 0; i != 12; ++i)
+    {
+        try
+        {
+            c.push_back(i);
+            fault_injection_disable dg;
+            expected.push_back(i);
+        }
+        catch (std::bad_alloc const&)
+        {
+            failed = true;
+        }
+    }
+
+    fault_injection_disable dg;
+    EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+    if (failed)
+        throw std::bad_alloc();
+}
+
+TEST(fault_injection, parallel_explores_same_sequences)
+{
+    std::atomic<size_t> serial_runs(0);
+    faulty_run([&]
+    {
+        retrying_workload(serial_runs);
+    });
+
+    for (unsigned threads : {1u, 2u, 3u, 8u})
+    {
+        std::atomic<size_t> parallel_runs(0);
+        faulty_run_parallel([&]
+        {
+            retrying_workload(parallel_runs);
+        }, threads);
+        // every worker ends with its own fault-free run
+        EXPECT_EQ(serial_runs + threads - 1, parallel_runs) << "threads = " << threads;
+    }
+}
+
+TEST(counted, concurrent_containers)
+{
+    counted::no_new_instances_guard g;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+    {
+        threads.emplace_back([t]
+        {
+            counted::no_new_instances_guard worker_guard;
+            container c;
+            for (int i = 0; i != 50000; ++i)
+            {
+                c.push_back(i * 4 + t);
+                if (i % 3 == 0)
+                    c.pop_front();
+            }
+            int expected = (50000 / 3 + 1) * 4 + t;
+            EXPECT_EQ(expected, c.front());
+            EXPECT_EQ(49999 * 4 + t, c.back());
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+}
+
+TEST(counted, guard_ignores_other_threads)
+{
+    counted::no_new_instances_guard g;
+
+    // another thread's instances stay alive past the guard's checks
+    std::atomic<bool> created(false);
+    std::atomic<bool> checked(false);
+    std::thread other([&]
+    {
+        counted a(1);
+        created = true;
+        while (!checked)
+            std::this_thread::yield();
+    });
+    while (!created)
+        std::this_thread::yield();
+    {
+        counted b(2);
+    }
+    g.expect_no_instances();
+    checked = true;
+    other.join();
+}
+
+TEST(memory_budget, accounts_members)
+{
+    memory_registry r;
+    {
+        tracked_deque<int> a(r);
+        tracked_deque<int> b(r);
+        EXPECT_EQ(2u, r.member_count());
+        EXPECT_EQ(0u, r.total_bytes());
+
+        for (int i = 0; i != 10; ++i)
+            a.push_back(i);
+        EXPECT_EQ(16 * sizeof(int), r.total_bytes());
+
+        tracked_deque<int> c = a;
+        EXPECT_EQ(3u, r.member_count());
+        EXPECT_EQ(32 * sizeof(int), r.total_bytes());
+
+        b = std::move(c);
+        EXPECT_EQ(32 * sizeof(int), r.total_bytes());
+        EXPECT_EQ(16 * sizeof(int), b.held_bytes());
+        EXPECT_EQ(0u, c.held_bytes());
+
+        swap(a, c);
+        EXPECT_EQ(16 * sizeof(int), c.held_bytes());
+        EXPECT_EQ(0u, a.held_bytes());
+        EXPECT_EQ(32 * sizeof(int), r.total_bytes());
+    }
+    EXPECT_EQ(0u, r.member_count());
+    EXPECT_EQ(0u, r.total_bytes());
+}
+
+TEST(memory_budget, accounts_bit_deques_in_bytes)
+{
+    memory_registry r;
+    {
+        tracked_deque<bool> a(r);
+        a.push_back(1000, true);
+        // 1024 bits
+        EXPECT_EQ(128u, a.held_bytes());
+
+        tracked_deque<bool> b = a;
+        EXPECT_EQ(128u, b.held_bytes());
+        EXPECT_EQ(256u, r.total_bytes());
+
+        tracked_deque<bool> c(r);
+        c = std::move(b);
+        EXPECT_EQ(128u, c.held_bytes());
+        EXPECT_EQ(0u, b.held_bytes());
+        EXPECT_EQ(256u, r.total_bytes());
+
+        b = c;
+        EXPECT_EQ(128u, b.held_bytes());
+        swap(a, c);
+        EXPECT_EQ(128u, a.held_bytes());
+        EXPECT_EQ(384u, r.total_bytes());
+    }
+    EXPECT_EQ(0u, r.total_bytes());
+}
+
+TEST(memory_budget, failed_reserve_keeps_deque)
+{
+    memory_registry r(8 * sizeof(int));
+    tracked_deque<int> c(r);
+    mass_push_back(c, {1, 2, 3, 4, 5, 6, 7, 8});
+
+    EXPECT_THROW(c.push_back(9), memory_budget_exceeded);
+    expect_eq(c, {1, 2, 3, 4, 5, 6, 7, 8});
+    EXPECT_EQ(8 * sizeof(int), r.total_bytes());
+
+    r.set_budget(16 * sizeof(int));
+    c.push_back(9);
+    EXPECT_EQ(16 * sizeof(int), r.total_bytes());
+}
+
+TEST(memory_budget, trim_idle)
+{
+    memory_registry r;
+    tracked_deque<int> busy(r);
+    tracked_deque<int> idle(r);
+    tracked_deque<int> drained(r);
+    for (int i = 0; i != 100; ++i)
+    {
+        busy.push_back(i);
+        idle.push_back(i);
+        drained.push_back(i);
+    }
+    while (idle.size() > 10)
+        idle.pop_back();
+    while (!drained.empty())
+        drained.pop_front();
+
+    // everything was used since joining
+    EXPECT_EQ(0u, r.trim_idle());
+
+    busy.push_back(100);
+    size_t released = r.trim_idle();
+    EXPECT_EQ((128 - 16 + 128) * sizeof(int), released);
+    EXPECT_EQ(128 * sizeof(int), busy.held_bytes());
+    EXPECT_EQ(16 * sizeof(int), idle.held_bytes());
+    EXPECT_EQ(0u, drained.held_bytes());
+    EXPECT_EQ(10u, idle.size());
+    EXPECT_EQ(9, idle.back());
+    EXPECT_EQ((128 + 16) * sizeof(int), r.total_bytes());
+}
+
+TEST(memory_budget, handler_trims_to_make_room)
+{
+    memory_registry r(64 * sizeof(int));
+    tracked_deque<int> idle(r);
+    tracked_deque<int> c(r);
+    for (int i = 0; i != 33; ++i)
+        idle.push_back(i);
+    idle.clear();
+    r.trim_idle();
+
+    size_t calls = 0;
+    r.set_over_budget_handler([&](memory_registry& reg, size_t)
+    {
+        ++calls;
+        return reg.trim_idle() != 0;
+    });
+
+    for (int i = 0; i != 40; ++i)
+        c.push_back(i);
+    EXPECT_EQ(1u, calls);
+    EXPECT_EQ(0u, idle.held_bytes());
+    EXPECT_EQ(64 * sizeof(int), r.total_bytes());
+    EXPECT_THROW(
+        for (int i = 0; i != 40; ++i)
+            c.push_back(i),
+        memory_budget_exceeded);
+    EXPECT_EQ(64u, c.size());
+}
+
+using recycled_container = my_deque<counted, deque_stats_disabled, deque_recycling_storage>;
+
+TEST(buffer_cache, reuses_freed_buffers)
+{
+    counted::no_new_instances_guard g;
+    buffer_cache::release_all();
+    buffer_cache_stats before = buffer_cache::thread_stats();
+
+    auto round = []
+    {
+        recycled_container c;
+        for (int i = 0; i != 20; ++i)
+            c.push_back(i);
+        EXPECT_EQ(19, c.back());
+    };
+
+    // growing to 32 elements takes five buffers
+    round();
+    buffer_cache_stats first = buffer_cache::thread_stats();
+    EXPECT_EQ(5u, first.misses - before.misses + first.local_hits - before.local_hits);
+    EXPECT_EQ(5u, first.recycled - before.recycled);
+
+    // later rounds find all of them in the cache again
+    for (int i = 0; i != 9; ++i)
+        round();
+    buffer_cache_stats after = buffer_cache::thread_stats();
+    EXPECT_EQ(first.misses, after.misses);
+    EXPECT_EQ(45u, after.local_hits - first.local_hits);
+    EXPECT_GT(after.retained_bytes, 0u);
+
+    buffer_cache::release_all();
+    EXPECT_EQ(0u, buffer_cache::thread_stats().retained_bytes);
+    EXPECT_EQ(0u, buffer_cache::global_retained_bytes());
+}
+
+TEST(buffer_cache, retention_is_bounded)
+{
+    buffer_cache::release_all();
+    {
+        std::vector<my_deque<int, deque_stats_disabled, deque_recycling_storage>> many(1000);
+        for (auto& c : many)
+            for (int i = 0; i != 1000; ++i)
+                c.push_back(i);
+    }
+    EXPECT_LE(buffer_cache::thread_stats().retained_bytes, buffer_cache::max_local_bytes);
+    EXPECT_LE(buffer_cache::global_retained_bytes(), buffer_cache::max_global_bytes);
+    EXPECT_GT(buffer_cache::thread_stats().evicted, 0u);
+    buffer_cache::release_all();
+}
+
+TEST(buffer_cache, spills_across_threads)
+{
+    buffer_cache::release_all();
+    std::vector<my_deque<int, deque_stats_disabled, deque_recycling_storage>> made(64);
+    std::thread producer([&]
+    {
+        for (auto& c : made)
+            for (int i = 0; i != 100; ++i)
+                c.push_back(i);
+    });
+    producer.join();
+
+    // the producer's cache went to the global pool when it exited
+    EXPECT_GT(buffer_cache::global_retained_bytes(), 0u);
+    made.clear();
+
+    buffer_cache_stats before = buffer_cache::thread_stats();
+    my_deque<int, deque_stats_disabled, deque_recycling_storage> c;
+    c.reserve(128);
+    EXPECT_EQ(before.misses, buffer_cache::thread_stats().misses);
+    buffer_cache::release_all();
+}
+
+TEST(reclaimer, retire_destroys_in_background)
+{
+    counted::no_new_instances_guard g;
+    background_reclaimer r;
+
+    container c;
+    for (int i = 0; i != 10000; ++i)
+        c.push_back(i);
+    r.retire(c);
+    EXPECT_TRUE(c.empty());
+    EXPECT_EQ(0u, c.capacity());
+
+    // the deque stays usable
+    mass_push_back(c, {1, 2, 3});
+    r.retire(std::move(c));
+    EXPECT_TRUE(c.empty());
+
+    r.drain();
+    EXPECT_EQ(0u, r.pending());
+}
+
+TEST(reclaimer, deferred_storage)
+{
+    counted::no_new_instances_guard g;
+    {
+        my_deque<counted, deque_stats_disabled, deque_deferred_storage> c;
+        for (int i = 0; i != 100000; ++i)
+            c.push_back(i);
+        for (int i = 0; i != 100000; ++i)
+        {
+            EXPECT_EQ(i, c.front());
+            c.pop_front();
+        }
+        c.shrink_to_fit();
+    }
+    background_reclaimer::instance().drain();
+    EXPECT_EQ(0u, background_reclaimer::instance().pending());
+}
+
+TEST(numa, places_large_buffers)
+{
+    int node = numa::current_node();
+    ASSERT_GE(node, 0);
+    ASSERT_LT(node, numa::node_count());
+
+    my_deque<int, deque_stats_disabled, deque_numa_storage> c;
+    {
+        numa::placement_scope scope(node);
+        for (int i = 0; i != 100000; ++i)
+            c.push_back(i);
+    }
+    ASSERT_GE(c.capacity() * sizeof(int), numa::min_placed_bytes);
+    EXPECT_EQ(node, numa::node_of(&c[0]));
+    EXPECT_EQ(node, numa::node_of(&c[c.size() - 1]));
+
+    // moving to another node is a reallocation under a different scope
+    {
+        numa::placement_scope scope(numa::node_count() - 1);
+        c.reserve(c.capacity());
+    }
+    EXPECT_EQ(numa::node_count() - 1, numa::node_of(&c[0]));
+    for (int i = 0; i != 100000; ++i)
+        ASSERT_EQ(i, c[i]);
+}
+
+TEST(numa, missing_node_falls_back)
+{
+    size_t failures = numa::placement_failures();
+    my_deque<int, deque_stats_disabled, deque_numa_storage> c;
+    {
+        numa::placement_scope scope(numa::node_count() + 7);
+        for (int i = 0; i != 100000; ++i)
+            c.push_back(i);
+    }
+    EXPECT_GT(numa::placement_failures(), failures);
+    EXPECT_EQ(99999, c.back());
+}
+
+TEST(spilling_deque, bounded_memory_fifo)
+{
+    // 64-element segments, at most 256 elements in memory
+    spilling_deque<uint64_t> q(256 * sizeof(uint64_t), 64 * sizeof(uint64_t));
+    size_t const n = 10000;
+    size_t peak = 0;
+    for (uint64_t i = 0; i != n; ++i) {
+        q.push_back(i);
+        peak = std::max(peak, q.in_memory());
+    }
+    EXPECT_EQ(n, q.size());
+    EXPECT_GT(q.spilled(), n / 2);
+    EXPECT_GE(q.stats().spilled_segments, n / 64 / 2);
+
+    for (uint64_t i = 0; i != n; ++i) {
+        ASSERT_EQ(i, q.front());
+        q.pop_front();
+        peak = std::max(peak, q.in_memory());
+    }
+    EXPECT_TRUE(q.empty());
+    EXPECT_LE(peak, 256u + 2 * 64);
+    EXPECT_EQ(q.stats().bytes_written, q.stats().bytes_read);
+}
+
+TEST(spilling_deque, bounded_memory_front_pushes)
+{
+    spilling_deque<uint64_t> q(256 * sizeof(uint64_t), 64 * sizeof(uint64_t));
+    size_t const n = 10000;
+    size_t peak = 0;
+    for (uint64_t i = 0; i != n; ++i) {
+        q.push_front(i);
+        peak = std::max(peak, q.in_memory());
+    }
+    EXPECT_EQ(n, q.size());
+    EXPECT_GT(q.spilled(), n / 2);
+    EXPECT_GE(q.stats().spilled_segments, n / 64 / 2);
+    EXPECT_LE(peak, 256u + 2 * 64);
+    EXPECT_LE(q.stats().bytes_written, n * sizeof(uint64_t));
+
+    // oldest at the back
+    for (uint64_t i = 0; i != n; ++i) {
+        ASSERT_EQ(i, q.back());
+        q.pop_back();
+        peak = std::max(peak, q.in_memory());
+    }
+    EXPECT_TRUE(q.empty());
+    EXPECT_LE(peak, 256u + 2 * 64);
+    EXPECT_EQ(q.stats().bytes_written, q.stats().bytes_read);
+}
+
+TEST(spilling_deque, reads_ahead_at_the_back)
+{
+    spilling_deque<uint64_t> q(256 * sizeof(uint64_t), 64 * sizeof(uint64_t));
+    size_t const n = 10000;
+    for (uint64_t i = 0; i != n; ++i) {
+        q.push_front(i);
+    }
+    size_t spilled_segments = q.stats().spilled_segments;
+    ASSERT_GT(spilled_segments, 0u);
+    for (uint64_t i = 0; i != n; ++i) {
+        ASSERT_EQ(i, q.back());
+        q.pop_back();
+    }
+    // every segment but the first to come back was asked for ahead of time
+    EXPECT_EQ(q.stats().loaded_segments, spilled_segments);
+    EXPECT_GE(q.stats().readahead_requests + 1, spilled_segments);
+}
+
+TEST(spilling_deque, matches_std_deque)
+{
+    spilling_deque<uint32_t> q(64 * sizeof(uint32_t), 16 * sizeof(uint32_t));
+    std::deque<uint32_t> expected;
+    std::mt19937 rng(7);
+    for (uint32_t i = 0; i != 50000; ++i) {
+        unsigned op = rng() % 8;
+        if (op < 4 || expected.empty()) {
+            q.push_back(i);
+            expected.push_back(i);
+        } else if (op == 4) {
+            q.push_front(i);
+            expected.push_front(i);
+        } else if (op == 5) {
+            ASSERT_EQ(expected.back(), q.back());
+            q.pop_back();
+            expected.pop_back();
+        } else {
+            ASSERT_EQ(expected.front(), q.front());
+            q.pop_front();
+            expected.pop_front();
+        }
+        ASSERT_EQ(expected.size(), q.size());
+    }
+    while (!expected.empty()) {
+        ASSERT_EQ(expected.back(), q.back());
+        q.pop_back();
+        expected.pop_back();
+    }
+    EXPECT_TRUE(q.empty());
+    EXPECT_GT(q.stats().loaded_segments, 0u);
+}
+
+TEST(spilling_deque, missing_directory_throws)
+{
+    EXPECT_THROW(spilling_deque<int>(1024, 256, "/nonexistent/spill"), std::system_error);
+}
+
+TEST(compressed_deque, timestamps_take_a_fraction_of_the_space)
+{
+    compressed_deque<uint64_t> c;
+    std::mt19937 rng(3);
+    uint64_t now = 1600000000000000ull;
+    std::vector<uint64_t> expected;
+    for (size_t i = 0; i != 100000; ++i) {
+        now += 900 + rng() % 200;
+        c.push_back(now);
+        expected.push_back(now);
+    }
+    ASSERT_EQ(expected.size(), c.size());
+    EXPECT_LT(c.memory_bytes() * 4, expected.size() * sizeof(uint64_t));
+
+    size_t i = 0;
+    for (uint64_t v : c) {
+        ASSERT_EQ(expected[i], v);
+        ++i;
+    }
+    EXPECT_EQ(expected.size(), i);
+    for (size_t j = 0; j < expected.size(); j += 997) {
+        EXPECT_EQ(expected[j], c[j]);
+    }
+    EXPECT_EQ(expected.front(), c.front());
+    EXPECT_EQ(expected.back(), c.back());
+}
+
+TEST(compressed_deque, matches_std_deque)
+{
+    compressed_deque<uint64_t> c;
+    std::deque<uint64_t> expected;
+    std::mt19937_64 rng(11);
+    for (size_t i = 0; i != 60000; ++i) {
+        unsigned op = unsigned(rng() % 10);
+        // mostly small steps, sometimes full-width values
+        uint64_t v = op == 9 ? rng() : (expected.empty() ? 0 : expected.back()) + rng() % 16 - 8;
+        if (op < 4 || expected.empty()) {
+            c.push_back(v);
+            expected.push_back(v);
+        } else if (op < 6) {
+            c.push_front(v);
+            expected.push_front(v);
+        } else if (op < 8) {
+            ASSERT_EQ(expected.back(), c.back());
+            c.pop_back();
+            expected.pop_back();
+        } else {
+            ASSERT_EQ(expected.front(), c.front());
+            c.pop_front();
+            expected.pop_front();
+        }
+        ASSERT_EQ(expected.size(), c.size());
+    }
+    EXPECT_GT(c.sealed_blocks(), 0u);
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), c.begin(), c.end()));
+    while (!c.empty()) {
+        ASSERT_EQ(expected.front(), c.front());
+        c.pop_front();
+        expected.pop_front();
+    }
+}
+
+TEST(compressed_deque, narrow_types_wrap)
+{
+    compressed_deque<uint16_t> c;
+    for (uint32_t i = 0; i != 1000; ++i) {
+        c.push_front(uint16_t(i * 40503u));
+    }
+    for (uint32_t i = 0; i != 1000; ++i) {
+        ASSERT_EQ(uint16_t((999 - i) * 40503u), c[i]);
+    }
+}
+
+TEST(bool_deque, matches_std_deque)
+{
+    my_deque<bool> c;
+    std::deque<bool> expected;
+    std::mt19937 rng(5);
+    for (size_t i = 0; i != 20000; ++i) {
+        unsigned op = rng() % 9;
+        bool v = rng() % 3 == 0;
+        if (op < 3 || expected.empty()) {
+            c.push_back(v);
+            expected.push_back(v);
+        } else if (op < 5) {
+            c.push_front(v);
+            expected.push_front(v);
+        } else if (op == 5) {
+            c.pop_back();
+            expected.pop_back();
+        } else if (op == 6) {
+            c.pop_front();
+            expected.pop_front();
+        } else if (op == 7) {
+            size_t index = rng() % (expected.size() + 1);
+            c.insert(c.begin() + index, v);
+            expected.insert(expected.begin() + index, v);
+        } else {
+            size_t index = rng() % expected.size();
+            c.erase(c.begin() + index);
+            expected.erase(expected.begin() + index);
+        }
+        ASSERT_EQ(expected.size(), c.size());
+    }
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), c.begin(), c.end()));
+    EXPECT_EQ(size_t(std::count(expected.begin(), expected.end(), true)), c.count());
+
+    my_deque<bool> const copy(c);
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), copy.begin(), copy.end()));
+}
+
+TEST(bool_deque, word_at_a_time_ops)
+{
+    my_deque<bool> c;
+    // start mid-word so everything below straddles words and wraps the ring
+    c.push_back(37, false);
+    c.pop_front(37);
+    c.push_back(100, false);
+    c.push_back(50, true);
+    c.push_front(true);
+    c.push_back(13, false);
+    ASSERT_EQ(164u, c.size());
+    EXPECT_EQ(51u, c.count());
+    EXPECT_EQ(50u, c.count(1, 164));
+    EXPECT_EQ(0u, c.find(true));
+    EXPECT_EQ(101u, c.find(true, 1));
+    EXPECT_EQ(151u, c.find(false, 101));
+    EXPECT_EQ(164u, c.find(true, 151));
+
+    c.flip();
+    EXPECT_EQ(113u, c.count());
+    EXPECT_EQ(1u, c.find(true));
+    c.flip(0);
+    EXPECT_TRUE(c[0]);
+    c[1] = false;
+    EXPECT_EQ(113u, c.count());
+
+    c.pop_front(101);
+    c.pop_back(13);
+    EXPECT_EQ(50u, c.size());
+    EXPECT_EQ(0u, c.count());
+    EXPECT_EQ(50u, c.find(true));
+}
+
+TEST(bool_deque, bulk_ops_count_every_element)
+{
+    my_deque<bool, deque_stats_enabled> bulk;
+    my_deque<bool, deque_stats_enabled> single;
+    my_deque<char, deque_stats_enabled> generic;
+    bulk.push_back(100, true);
+    bulk.pop_front(30);
+    bulk.pop_back(20);
+    bulk.resize(70, false);
+    for (int i = 0; i != 100; ++i) {
+        single.push_back(true);
+        generic.push_back(1);
+    }
+    for (int i = 0; i != 30; ++i) {
+        single.pop_front();
+        generic.pop_front();
+    }
+    for (int i = 0; i != 20; ++i) {
+        single.pop_back();
+        generic.pop_back();
+    }
+    single.resize(70, false);
+    generic.resize(70, 0);
+
+    for (my_deque_stats const &s : {single.stats(), generic.stats()}) {
+        EXPECT_EQ(s.push_back, bulk.stats().push_back);
+        EXPECT_EQ(s.pop_front, bulk.stats().pop_front);
+        EXPECT_EQ(s.pop_back, bulk.stats().pop_back);
+        EXPECT_EQ(s.peak_size, bulk.stats().peak_size);
+    }
+    EXPECT_EQ(100u, bulk.stats().push_back);
+    EXPECT_EQ(30u, bulk.stats().pop_front);
+    EXPECT_EQ(20u, bulk.stats().pop_back);
+}
+
+TEST(bool_deque, packs_eight_per_byte)
+{
+    my_deque<bool> c(1 << 16, true);
+    EXPECT_EQ(size_t(1 << 16) / 8, c.memory_usage().payload_bytes + c.memory_usage().slack_bytes);
+    EXPECT_EQ(size_t(1 << 16), c.count());
+    EXPECT_EQ(3 * sizeof(void *), sizeof(c));
+}
+
+TEST(spans, cover_the_ring_in_order)
+{
+    my_deque<int> c;
+    EXPECT_TRUE(c.spans().first.empty());
+    for (int i = 0; i != 6; ++i) {
+        c.push_back(i);
+    }
+    c.pop_front();
+    c.pop_front();
+    c.push_back(6);
+    c.push_back(7);
+    c.push_back(8);
+    // capacity 8, head at 2: [2..7] then [8]
+    auto spans = c.spans();
+    ASSERT_EQ(6u, spans.first.size);
+    ASSERT_EQ(1u, spans.second.size);
+    std::vector<int> seen(spans.first.begin(), spans.first.end());
+    seen.insert(seen.end(), spans.second.begin(), spans.second.end());
+    EXPECT_EQ(std::vector<int>({2, 3, 4, 5, 6, 7, 8}), seen);
+}
+
+TEST(soa_deque, rows_and_columns)
+{
+    soa_deque<uint64_t, double, std::string> c;
+    std::deque<std::tuple<uint64_t, double, std::string>> expected;
+    std::mt19937 rng(9);
+    for (uint64_t i = 0; i != 5000; ++i) {
+        unsigned op = rng() % 6;
+        if (op < 2 || expected.empty()) {
+            c.push_back(i, i * 0.5, std::to_string(i));
+            expected.emplace_back(i, i * 0.5, std::to_string(i));
+        } else if (op == 2) {
+            c.push_front(i, -1.0, "f");
+            expected.emplace_front(i, -1.0, "f");
+        } else if (op == 3) {
+            c.pop_back();
+            expected.pop_back();
+        } else if (op == 4) {
+            c.pop_front();
+            expected.pop_front();
+        } else {
+            std::get<2>(c.front()) += "!";
+            std::get<2>(expected.front()) += "!";
+        }
+        ASSERT_EQ(expected.size(), c.size());
+    }
+    soa_deque<uint64_t, double, std::string> const copy(c);
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), copy.begin(), copy.end()));
+
+    uint64_t sum = 0;
+    auto ids = copy.column<0>();
+    for (uint64_t id : ids.first) {
+        sum += id;
+    }
+    for (uint64_t id : ids.second) {
+        sum += id;
+    }
+    uint64_t expected_sum = 0;
+    for (auto const &row : expected) {
+        expected_sum += std::get<0>(row);
+    }
+    EXPECT_EQ(expected_sum, sum);
+    EXPECT_EQ(expected.size(), ids.first.size + ids.second.size);
+}
+
+TEST(soa_deque, failed_growth_keeps_rows)
+{
+    counted::no_new_instances_guard g;
+    soa_deque<int, counted> c;
+    for (int i = 0; i != 8; ++i) {
+        c.push_back(i, counted(i));
+    }
+    faulty_run([&] {
+        soa_deque<int, counted> copy(c);
+        try {
+            copy.push_back(8, counted(8));
+        } catch (...) {
+            EXPECT_EQ(8u, copy.size());
+            for (int i = 0; i != 8; ++i) {
+                EXPECT_EQ(i, std::get<0>(copy[i]));
+                EXPECT_EQ(i, int(std::get<1>(copy[i])));
+            }
+            throw;
+        }
+    });
+}
+
+TEST(soa_deque, copy_allocates_once)
+{
+    soa_deque<uint64_t, double> c;
+    for (uint64_t i = 0; i != 100000; ++i) {
+        c.push_back(i, i * 0.25);
+    }
+    // wrap the ring so the copy reads two runs per column
+    for (uint64_t i = 0; i != 1000; ++i) {
+        c.pop_front();
+        c.push_back(i, i * 0.25);
+    }
+
+    reset_allocation_profile();
+    enable_allocation_profiling(true);
+    soa_deque<uint64_t, double> const copy(c);
+    enable_allocation_profiling(false);
+    size_t allocations = 0;
+    for (allocation_site const &site : allocation_profile()) {
+        allocations += site.count;
+    }
+    EXPECT_EQ(1u, allocations);
+    EXPECT_EQ(c.capacity(), copy.capacity());
+    ASSERT_EQ(c.size(), copy.size());
+    EXPECT_TRUE(std::equal(c.begin(), c.end(), copy.begin(), copy.end()));
+}
+
+TEST(timer_wheel, fires_each_live_timer_once_on_time)
+{
+    timer_wheel<uint64_t> wheel(1000);
+    std::mt19937_64 rng(17);
+    std::multiset<uint64_t> pending;
+    std::vector<std::pair<timer_handle, uint64_t>> handles;
+    for (size_t i = 0; i != 20000; ++i) {
+        // every level, and some already due
+        uint64_t deadline = 1000 + (rng() % 4 == 0 ? rng() % (uint64_t(1) << 30) : rng() % 70000) - 50;
+        uint64_t due = std::max<uint64_t>(deadline, 1000);
+        handles.emplace_back(wheel.schedule(deadline, due), due);
+        pending.insert(handles.back().second);
+    }
+    for (size_t i = 0; i < handles.size(); i += 3) {
+        EXPECT_TRUE(wheel.cancel(handles[i].first));
+        EXPECT_FALSE(wheel.cancel(handles[i].first));
+        pending.erase(pending.find(handles[i].second));
+    }
+    ASSERT_EQ(pending.size(), wheel.size());
+
+    uint64_t previous = 999;
+    while (!wheel.empty()) {
+        uint64_t now = previous + 1 + rng() % 5000;
+        wheel.advance(now, [&](timer_handle, uint64_t deadline) {
+            ASSERT_GT(deadline, previous);
+            ASSERT_LE(deadline, now);
+            auto it = pending.find(deadline);
+            ASSERT_NE(pending.end(), it);
+            pending.erase(it);
+        });
+        ASSERT_TRUE(pending.empty() || *pending.begin() > now);
+        previous = now;
+    }
+    EXPECT_TRUE(pending.empty());
+}
+
+TEST(timer_wheel, idle_wheel_drops_cancelled_entries)
+{
+    timer_wheel<int> wheel;
+    uint64_t now = 0;
+    for (int i = 0; i != 200000; ++i) {
+        // connection timeouts that are cancelled when the reply comes in
+        timer_handle h = wheel.schedule(now + 30000 + uint64_t(i % 3) * 5000000000ull, i);
+        EXPECT_TRUE(wheel.cancel(h));
+        now += 7;
+        EXPECT_EQ(0u, wheel.advance(now, [](timer_handle, int) {}));
+        if (i % 1000 == 0)
+            ASSERT_EQ(0u, wheel.stored()) << "i = " << i;
+    }
+    EXPECT_EQ(0u, wheel.size());
+    EXPECT_EQ(0u, wheel.stored());
+
+    // dead entries among live ones go as their slots are reached
+    timer_handle dead = wheel.schedule(now + 10, 0);
+    wheel.schedule(now + 20, 1);
+    wheel.cancel(dead);
+    EXPECT_EQ(2u, wheel.stored());
+    EXPECT_EQ(1u, wheel.advance(now + 20, [](timer_handle, int v) { EXPECT_EQ(1, v); }));
+    EXPECT_EQ(0u, wheel.stored());
+}
+
+TEST(timer_wheel, callbacks_reschedule)
+{
+    timer_wheel<int> wheel;
+    std::vector<uint64_t> fired_at;
+    wheel.schedule(10, 0);
+    // one far beyond the top level
+    uint64_t far = (uint64_t(1) << 33) + 5;
+    timer_handle far_handle = wheel.schedule(far, -1);
+    wheel.advance(uint64_t(1) << 20, [&](timer_handle, int n) {
+        fired_at.push_back(wheel.now());
+        if (n < 5) {
+            // same tick first, then one later
+            wheel.schedule(wheel.now() + (n % 2) * 300, n + 1);
+        }
+    });
+    EXPECT_EQ(std::vector<uint64_t>({10, 10, 310, 310, 610, 610}), fired_at);
+    EXPECT_EQ(1u, wheel.size());
+
+    size_t fired = wheel.advance(far, [&](timer_handle h, int n) {
+        EXPECT_EQ(-1, n);
+        EXPECT_EQ(far_handle.index, h.index);
+        EXPECT_EQ(far, wheel.now());
+    });
+    EXPECT_EQ(1u, fired);
+    EXPECT_TRUE(wheel.empty());
+}
+
+namespace {
+    template<typename Aggregator, typename Naive>
+    void check_window(Aggregator &window, Naive naive, std::function<typename Naive::value_type(size_t)> make)
+    {
+        std::deque<typename Naive::value_type> expected;
+        std::mt19937 rng(21);
+        for (size_t i = 0; i != 20000; ++i) {
+            if (expected.empty() || (expected.size() < 300 && rng() % 5 < 3)) {
+                expected.push_back(make(i));
+                window.push(expected.back());
+            } else {
+                expected.pop_front();
+                window.pop();
+            }
+            ASSERT_EQ(expected.size(), window.size());
+            if (!expected.empty()) {
+                ASSERT_EQ(naive(expected), window.query());
+            }
+        }
+    }
+
+    template<typename T, typename F>
+    struct naive_fold {
+        using value_type = T;
+        F f;
+
+        T operator()(std::deque<T> const &values) const
+        {
+            T res = values.front();
+            for (size_t i = 1; i != values.size(); ++i) {
+                res = f(res, values[i]);
+            }
+            return res;
+        }
+    };
+}
+
+TEST(window_aggregator, sum_min_max)
+{
+    window_aggregator<int64_t> sum;
+    check_window(sum, naive_fold<int64_t, std::plus<int64_t>>(), [](size_t i) { return int64_t(i * 7919 % 1000) - 500; });
+
+    window_aggregator<int, agg_min<int>> min;
+    check_window(min, naive_fold<int, agg_min<int>>(), [](size_t i) { return int(i * 7919 % 1000); });
+
+    window_aggregator<int, agg_max<int>> max;
+    check_window(max, naive_fold<int, agg_max<int>>(), [](size_t i) { return int(i * 7919 % 100); });
+}
+
+TEST(window_aggregator, keeps_order_for_non_commutative_ops)
+{
+    struct concat {
+        std::string operator()(std::string const &a, std::string const &b) const
+        {
+            return a + b;
+        }
+    };
+    window_aggregator<std::string, concat> window;
+    std::deque<std::string> expected;
+    for (int i = 0; i != 300; ++i) {
+        expected.push_back(std::string(1, char('a' + i % 26)));
+        window.push(expected.back());
+        if (i % 3 == 2) {
+            expected.pop_front();
+            window.pop();
+        }
+        std::string joined;
+        for (auto const &s : expected) {
+            joined += s;
+        }
+        ASSERT_EQ(joined, window.query());
+    }
+}
+
+TEST(timed_deque, evicts_and_queries_across_the_wrap)
+{
+    timed_deque<int> log;
+    std::deque<std::pair<uint64_t, int>> expected;
+    std::mt19937 rng(13);
+    uint64_t now = 0;
+    for (int i = 0; i != 20000; ++i) {
+        now += rng() % 3;
+        log.push_back(now, i);
+        expected.emplace_back(now, i);
+        if (i % 7 == 0) {
+            uint64_t horizon = now - std::min<uint64_t>(now, rng() % 400);
+            size_t n = 0;
+            while (!expected.empty() && expected.front().first < horizon) {
+                expected.pop_front();
+                n++;
+            }
+            ASSERT_EQ(n, log.evict_before(horizon));
+            ASSERT_EQ(expected.size(), log.size());
+        }
+        if (i % 11 == 0 && !expected.empty()) {
+            uint64_t from = expected.front().first + rng() % 200;
+            uint64_t to = from + rng() % 200;
+            std::vector<int> want;
+            for (auto const &e : expected) {
+                if (e.first >= from && e.first < to) {
+                    want.push_back(e.second);
+                }
+            }
+            auto spans = log.range(from, to);
+            std::vector<int> got;
+            for (auto const &e : spans.first) {
+                got.push_back(e.value);
+            }
+            for (auto const &e : spans.second) {
+                got.push_back(e.value);
+            }
+            ASSERT_EQ(want, got);
+            ASSERT_EQ(want.size(), log.count(from, to));
+        }
+    }
+    EXPECT_EQ(expected.front().second, log.front().value);
+    size_t left = log.size();
+    EXPECT_EQ(left, log.evict_before(now + 1));
+    EXPECT_TRUE(log.empty());
+}
+
+TEST(timed_deque, rejects_time_going_backwards)
+{
+    timed_deque<int> log;
+    log.push_back(10, 1);
+    log.push_back(10, 2);
+    EXPECT_THROW(log.push_back(9, 3), std::invalid_argument);
+    EXPECT_EQ(2u, log.size());
+    EXPECT_EQ(0u, log.evict_before(10));
+    EXPECT_EQ(2u, log.evict_before(11));
+}
+
+TEST(multires_ring, answers_from_coarse_levels)
+{
+    uint64_t const second = 1000, minute = 60 * second, hour = 60 * minute;
+    multires_ring ring(500, {{second, 120}, {minute, 90}, {hour, 100}});
+    std::vector<std::pair<uint64_t, double>> all;
+    std::mt19937 rng(23);
+    uint64_t now = 5 * hour + 123;
+    while (now < 60 * hour) {
+        double value = double(rng() % 1000);
+        ring.push(now, value);
+        all.emplace_back(now, value);
+        now += 1 + rng() % 700;
+    }
+
+    // want_from is where the answer starts when from is older than what the
+    // finer levels still hold
+    auto expect_exact = [&](uint64_t from, uint64_t to, uint64_t want_from) {
+        series_summary want;
+        for (auto const &s : all) {
+            if (s.first >= want_from && s.first < to) {
+                want.add(s.second);
+            }
+        }
+        series_summary got = ring.query(from, to);
+        ASSERT_EQ(want.count, got.count) << from << ".." << to;
+        ASSERT_EQ(want.sum, got.sum);
+        if (want.count != 0) {
+            ASSERT_EQ(want.min, got.min);
+            ASSERT_EQ(want.max, got.max);
+        }
+    };
+
+    // whole hours reach back to the start, whole minutes for the last 90,
+    // anything for what the raw ring still holds
+    expect_exact(0, now + 1, 0);
+    for (uint64_t h = 0; h < 60; h += 7) {
+        expect_exact(h * hour, (h + 3) * hour, h * hour);
+    }
+    for (uint64_t m = now / minute - 85; m < now / minute; m += 4) {
+        expect_exact(m * minute, (m + 1 + rng() % 5) * minute, m * minute);
+    }
+    for (int i = 0; i != 50; ++i) {
+        uint64_t from = now - rng() % (100 * second);
+        expect_exact(from, from + rng() % (30 * second), from);
+    }
+    // seconds are gone this far back, so the first minute counts whole
+    for (uint64_t ago = 10; ago < 80; ago += 7) {
+        uint64_t from = now - ago * minute + 12345;
+        expect_exact(from, now + 1, from - from % minute);
+    }
+
+    EXPECT_LE(ring.level_size(0), 500u);
+    EXPECT_LE(ring.level_size(1), 121u);
+    EXPECT_LE(ring.level_size(2), 91u);
+    EXPECT_LE(ring.level_size(3), 101u);
+}
+
+TEST(multires_ring, rejects_bad_levels)
+{
+    EXPECT_THROW(multires_ring(16, {{1000, 4}, {1500, 4}}), std::invalid_argument);
+    EXPECT_THROW(multires_ring(16, {{1000, 4}, {1000, 4}}), std::invalid_argument);
+    EXPECT_THROW(multires_ring(0), std::invalid_argument);
+    multires_ring ring(16);
+    ring.push(5, 1);
+    EXPECT_THROW(ring.push(4, 1), std::invalid_argument);
+}
+
+// Out of line and with external linkage, so it stays a frame of its own
+// with an exported name even when my_deque's members are inlined into it.
+__attribute__((noinline)) void profiled_deque_growth()
+{
+    my_deque<int> c;
+    for (int i = 0; i != 64; ++i)
+        c.push_back(i);
+}
+
+TEST(alloc_profiler, attributes_deque_growth)
+{
+    reset_allocation_profile();
+    enable_allocation_profiling(true);
+    profiled_deque_growth();
+    enable_allocation_profiling(false);
+
+    size_t growth_count = 0;
+    size_t growth_bytes = 0;
+    for (allocation_site const& site : allocation_profile())
+    {
+        ASSERT_FALSE(site.frames.empty());
+        for (std::string const& frame : site.frames)
+        {
+            if (frame.find("profiled_deque_growth") != std::string::npos)
+            {
+                growth_count += site.count;
+                growth_bytes += site.bytes;
+                break;
+            }
+        }
+    }
+
+    // capacity grows 2, 4, 8, 16, 32, 64
+    EXPECT_EQ(6u, growth_count);
+    EXPECT_EQ((2u + 4 + 8 + 16 + 32 + 64) * sizeof(int), growth_bytes);
+}
+
+// push_back shrinks an underfull buffer, so reserve() can't be used to get
+// spare capacity; pushing `spare` extra elements and popping them can.
+template <typename T>
+my_deque<T> make_instrumented(size_t n, size_t spare = 0)
+{
+    my_deque<T> c;
+    for (size_t i = 0; i != n + spare; ++i)
+        c.push_back(T(static_cast<int>(i)));
+    for (size_t i = 0; i != spare; ++i)
+        c.pop_back();
+    return c;
+}
+
+TEST(complexity, growth_moves_nothrow_movable)
+{
+    my_deque<instrumented> c = make_instrumented<instrumented>(16);
+    ASSERT_EQ(16u, c.capacity());
+
+    instrumented x(16);
+    instrumented::reset_counts();
+    c.push_back(x);
+
+    EXPECT_EQ(32u, c.capacity());
+    EXPECT_EQ(16u, instrumented::counts.moves);
+    EXPECT_EQ(1u, instrumented::counts.all_copies());
+    EXPECT_EQ(16u, instrumented::counts.destructions);
+}
+
+TEST(complexity, growth_copies_throwing_movable)
+{
+    my_deque<instrumented_throwing_move> c = make_instrumented<instrumented_throwing_move>(16);
+
+    instrumented_throwing_move x(16);
+    instrumented_throwing_move::reset_counts();
+    c.push_back(x);
+
+    EXPECT_EQ(0u, instrumented_throwing_move::counts.all_moves());
+    EXPECT_EQ(17u, instrumented_throwing_move::counts.copies);
+}
+
+TEST(complexity, push_rvalue)
+{
+    my_deque<instrumented> c = make_instrumented<instrumented>(4, 1);
+
+    instrumented::reset_counts();
+    c.push_back(instrumented(1));
+    c.push_front(instrumented(2));
+
+    EXPECT_EQ(2u, instrumented::counts.moves);
+    EXPECT_EQ(0u, instrumented::counts.all_copies());
+}
+
+TEST(complexity, move_deque)
+{
+    my_deque<instrumented> c = make_instrumented<instrumented>(10);
+
+    instrumented::reset_counts();
+    my_deque<instrumented> c2 = std::move(c);
+    c = std::move(c2);
+
+    EXPECT_EQ(0u, instrumented::counts.all_moves());
+    EXPECT_EQ(0u, instrumented::counts.all_copies());
+    EXPECT_EQ(0u, instrumented::counts.destructions);
+    EXPECT_EQ(10u, c.size());
+}
+
+TEST(complexity, insert_shifts_shorter_side)
+{
+    size_t const n = 16;
+    for (size_t i = 0; i <= n; ++i)
+    {
+        my_deque<instrumented> c = make_instrumented<instrumented>(n, 1);
+        instrumented x(-1);
+
+        instrumented::reset_counts();
+        c.insert(c.begin() + i, x);
+
+        EXPECT_LE(instrumented::counts.all_moves(), std::min(i, n - i) + 1) << "i = " << i;
+        EXPECT_EQ(1u, instrumented::counts.all_copies()) << "i = " << i;
+        EXPECT_EQ(-1, c[i]);
+        EXPECT_EQ(n + 1, c.size());
+    }
+}
+
+TEST(complexity, erase_shifts_shorter_side)
+{
+    size_t const n = 16;
+    for (size_t i = 0; i != n; ++i)
+    {
+        my_deque<instrumented> c = make_instrumented<instrumented>(n);
+
+        instrumented::reset_counts();
+        c.erase(c.begin() + i);
+
+        EXPECT_LE(instrumented::counts.all_moves(), std::min(i, n - i - 1)) << "i = " << i;
+        EXPECT_EQ(0u, instrumented::counts.all_copies()) << "i = " << i;
+        EXPECT_EQ(1u, instrumented::counts.destructions) << "i = " << i;
+        for (size_t k = 0; k != n - 1; ++k)
+            EXPECT_EQ(static_cast<int>(k < i ? k : k + 1), c[k]);
+    }
+}
+
+// every sequence the performance fuzzer once flagged, replayed against the
+// same bounds it was flagged by
+TEST(complexity, perf_regressions)
+{
+    size_t replayed = 0;
+    for (std::filesystem::directory_entry const& file : std::filesystem::directory_iterator(DEQUE_PERF_REGRESSIONS_DIR))
+    {
+        if (file.path().extension() != ".bin")
+            continue;
+        std::ifstream in(file.path(), std::ios::binary);
+        ASSERT_TRUE(in.good()) << file.path();
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        instrumented::reset_counts();
+        perf_fuzz::cost c = perf_fuzz::run(data.data(), data.size());
+        EXPECT_FALSE(perf_fuzz::pathological(c))
+            << file.path() << ": work " << c.work << ", relocated " << c.relocated
+            << ", excess shifts " << c.excess_shift << '\n'
+            << perf_fuzz::describe(data.data(), data.size());
+        replayed++;
+    }
+    EXPECT_NE(0u, replayed);
+}
+
+TEST(correctness, insert_self_reference)
+{
+    counted::no_new_instances_guard g;
+
+    container c;
+    mass_push_back(c, {1, 2, 3, 4});
+    c.insert(c.begin() + 1, c[3]);
+    c.insert(c.begin() + 4, c[0]);
+    expect_eq(c, {1, 4, 2, 3, 1, 4});
+}
@@ -0,0 +1,153 @@
+#ifndef EXAM_DEQUE_TIMED_DEQUE_H
+#define EXAM_DEQUE_TIMED_DEQUE_H
+
+#include "my_deque.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+// Entries in timestamp order, for windows that drop everything older than
+// a horizon: rate limiter logs, recent-event caches. The ring's elements
+// form at most two sorted runs (see my_deque::spans()), so any time
+// boundary is one binary search over one of them, and eviction is a single
+// consume_front of everything before it rather than a pop per entry.
+template<typename T, typename Time = uint64_t>
+class timed_deque {
+public:
+    struct entry {
+        Time time;
+        T value;
+    };
+
+    // time must not be earlier than that of the newest entry
+    void push_back(Time time, T value);
+    void pop_front();
+
+    // drops every entry older than horizon and returns how many
+    size_t evict_before(Time horizon) noexcept;
+
+    // index of the first entry at or after time, or size()
+    size_t lower_bound(Time time) const noexcept;
+    // entries with from <= time < to
+    deque_spans<entry const> range(Time from, Time to) const noexcept;
+    size_t count(Time from, Time to) const noexcept;
+
+    entry const &front() const noexcept;
+    entry const &back() const noexcept;
+    entry const &operator[](size_t index) const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    void clear() noexcept;
+
+private:
+    // Branchless lower bound: the range halves every step and the choice of
+    // half is a conditional move, so the loop runs log2(size) times with no
+    // mispredicted branch.
+    static size_t lower_bound_(deque_span<entry const> span, Time time) noexcept {
+        if (span.size == 0) {
+            return 0;
+        }
+        entry const *base = span.data;
+        size_t n = span.size;
+        while (n > 1) {
+            size_t half = n / 2;
+            base = base[half - 1].time < time ? base + half : base;
+            n -= half;
+        }
+        return size_t(base - span.data) + (base->time < time);
+    }
+
+    my_deque<entry> entries_;
+};
+
+template<typename T, typename Time>
+void timed_deque<T, Time>::push_back(Time time, T value) {
+    if (!entries_.empty() && time < entries_.back().time) {
+        throw std::invalid_argument("timed_deque: time goes backwards");
+    }
+    entries_.push_back(entry{time, std::move(value)});
+}
+
+template<typename T, typename Time>
+void timed_deque<T, Time>::pop_front() {
+    entries_.pop_front();
+}
+
+template<typename T, typename Time>
+size_t timed_deque<T, Time>::evict_before(Time horizon) noexcept {
+    size_t n = lower_bound(horizon);
+    entries_.consume_front(n);
+    return n;
+}
+
+template<typename T, typename Time>
+size_t timed_deque<T, Time>::lower_bound(Time time) const noexcept {
+    deque_spans<entry const> runs = entries_.spans();
+    // the second run is newer: search it only if the first ends too early
+    if (!runs.second.empty() && runs.first[runs.first.size - 1].time < time) {
+        return runs.first.size + lower_bound_(runs.second, time);
+    }
+    return lower_bound_(runs.first, time);
+}
+
+template<typename T, typename Time>
+deque_spans<typename timed_deque<T, Time>::entry const> timed_deque<T, Time>::range(Time from, Time to) const noexcept {
+    size_t first = lower_bound(from);
+    size_t last = std::max(first, lower_bound(to));
+    deque_spans<entry const> runs = entries_.spans();
+    deque_spans<entry const> res;
+    // [first, last) cut out of the two runs
+    if (first < runs.first.size) {
+        size_t end = std::min(last, runs.first.size);
+        res.first = {runs.first.data + first, end - first};
+        if (last > runs.first.size) {
+            res.second = {runs.second.data, last - runs.first.size};
+        }
+    } else if (first != last) {
+        res.first = {runs.second.data + (first - runs.first.size), last - first};
+    }
+    return res;
+}
+
+template<typename T, typename Time>
+size_t timed_deque<T, Time>::count(Time from, Time to) const noexcept {
+    size_t first = lower_bound(from);
+    size_t last = lower_bound(to);
+    return last > first ? last - first : 0;
+}
+
+template<typename T, typename Time>
+typename timed_deque<T, Time>::entry const &timed_deque<T, Time>::front() const noexcept {
+    return entries_.front();
+}
+
+template<typename T, typename Time>
+typename timed_deque<T, Time>::entry const &timed_deque<T, Time>::back() const noexcept {
+    return entries_.back();
+}
+
+template<typename T, typename Time>
+typename timed_deque<T, Time>::entry const &timed_deque<T, Time>::operator[](size_t index) const noexcept {
+    return entries_[index];
+}
+
+template<typename T, typename Time>
+size_t timed_deque<T, Time>::size() const noexcept {
+    return entries_.size();
+}
+
+template<typename T, typename Time>
+bool timed_deque<T, Time>::empty() const noexcept {
+    return entries_.empty();
+}
+
+template<typename T, typename Time>
+void timed_deque<T, Time>::clear() noexcept {
+    entries_.clear();
+}
+
+#endif //EXAM_DEQUE_TIMED_DEQUE_H
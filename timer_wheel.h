@@ -0,0 +1,266 @@
+#ifndef EXAM_DEQUE_TIMER_WHEEL_H
+#define EXAM_DEQUE_TIMER_WHEEL_H
+
+#include "my_deque.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct timer_handle {
+    uint32_t index;
+    uint32_t generation;
+};
+
+// Hierarchical timing wheel over integer ticks: levels of 256 slots, each
+// slot a my_deque of entries, level L covering 256^(L+1) ticks. A timer
+// goes to the lowest level whose range still tells its deadline apart from
+// the current tick, found from the highest bit in which they differ, so
+// schedule is O(1). When the level below wraps, the slot that has become
+// current cascades down one level; level 0 slots hold timers due at exactly
+// that tick and are drained whole. Deadlines beyond the top level wait in
+// an overflow deque that is sorted back in each time the top level wraps.
+// advance() skips from one non-empty slot to the next, so idle stretches
+// cost one scan of the wheel rather than a step per tick.
+//
+// Cancelling is O(1) and lazy: every timer owns an index into generations_,
+// and an entry is live while its generation matches. cancel() bumps the
+// generation and frees the index for reuse; the dead entry is dropped when
+// its slot is drained or cascaded, or, since advance() skips ahead without
+// visiting slots once no timer is live, when the wheel is found empty.
+template<typename T>
+class timer_wheel {
+public:
+    static constexpr unsigned slot_bits = 8;
+    static constexpr unsigned levels = 4;
+    static constexpr size_t slots = size_t(1) << slot_bits;
+
+    explicit timer_wheel(uint64_t now = 0);
+
+    // deadline is in ticks; timers already due fire on the next advance()
+    timer_handle schedule(uint64_t deadline, T value);
+    // false if the timer has already fired or been cancelled
+    bool cancel(timer_handle handle) noexcept;
+
+    // fires every timer due at or before now, in deadline order, as
+    // f(handle, value); f may schedule and cancel timers. If f throws, the
+    // timers after the one it threw for stay due.
+    template<typename F>
+    size_t advance(uint64_t now, F &&f);
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    // entries held, live or cancelled and not yet dropped; O(slots)
+    size_t stored() const noexcept;
+    // next tick advance() will look at
+    uint64_t now() const noexcept;
+
+private:
+    struct entry {
+        uint64_t deadline;
+        timer_handle handle;
+        T value;
+    };
+
+    bool live_(timer_handle handle) const noexcept {
+        return generations_[handle.index] == handle.generation;
+    }
+
+    // First tick after current_ that drains or cascades a non-empty slot.
+    // Slots ahead of a level's current one are due in this rotation, so the
+    // lowest level with one has the earliest.
+    uint64_t next_event_() const noexcept {
+        for (unsigned level = 0; level != levels; ++level) {
+            unsigned shift = slot_bits * level;
+            uint64_t rotation = (uint64_t(1) << (shift + slot_bits)) - 1;
+            for (size_t j = ((current_ >> shift) & (slots - 1)) + 1; j < slots; ++j) {
+                if (!wheel_[level][j].empty()) {
+                    return (current_ & ~rotation) + (uint64_t(j) << shift);
+                }
+            }
+        }
+        uint64_t top = uint64_t(1) << (slot_bits * levels);
+        return (current_ & ~(top - 1)) + top;
+    }
+
+    void place_(entry &&e);
+    void cascade_(my_deque<entry> &slot);
+
+    my_deque<entry> wheel_[levels][slots];
+    my_deque<entry> overflow_;
+    // a slot is swapped in here while it is drained, so callbacks can add
+    // to the slot itself
+    my_deque<entry> draining_;
+    std::vector<uint32_t> generations_;
+    my_deque<uint32_t> free_;
+    uint64_t current_;
+    size_t live_count_ = 0;
+    // cancelled entries still held somewhere in the wheel
+    size_t dead_count_ = 0;
+};
+
+template<typename T>
+timer_wheel<T>::timer_wheel(uint64_t now) : current_(now) {}
+
+template<typename T>
+timer_handle timer_wheel<T>::schedule(uint64_t deadline, T value) {
+    bool reused = !free_.empty();
+    uint32_t index;
+    if (reused) {
+        index = free_.front();
+    } else {
+        index = uint32_t(generations_.size());
+        generations_.push_back(0);
+    }
+    timer_handle handle{index, generations_[index]};
+    place_(entry{std::max(deadline, current_), handle, std::move(value)});
+    if (reused) {
+        free_.pop_front();
+    }
+    live_count_++;
+    return handle;
+}
+
+template<typename T>
+bool timer_wheel<T>::cancel(timer_handle handle) noexcept {
+    if (handle.index >= generations_.size() || !live_(handle)) {
+        return false;
+    }
+    generations_[handle.index]++;
+    live_count_--;
+    dead_count_++;
+    // a free_ that cannot grow leaks the index; it is never reused then
+    try {
+        free_.push_back(handle.index);
+    } catch (...) {
+    }
+    return true;
+}
+
+template<typename T>
+template<typename F>
+size_t timer_wheel<T>::advance(uint64_t now, F &&f) {
+    size_t fired = 0;
+    while (current_ <= now) {
+        if (live_count_ == 0) {
+            // nothing to cascade or fire; whatever is held is dead, and
+            // would never be visited once current_ skips past it
+            if (dead_count_ != 0) {
+                for (auto &level : wheel_) {
+                    for (my_deque<entry> &slot : level) {
+                        slot.clear();
+                    }
+                }
+                overflow_.clear();
+                dead_count_ = 0;
+            }
+            current_ = now + 1;
+            break;
+        }
+        // cascade from the top so entries can fall more than one level
+        for (unsigned level = levels; level-- > 1;) {
+            uint64_t low = (uint64_t(1) << (slot_bits * level)) - 1;
+            if ((current_ & low) == 0) {
+                if (level == levels - 1 && ((current_ >> (slot_bits * levels)) << (slot_bits * levels)) == current_) {
+                    cascade_(overflow_);
+                }
+                cascade_(wheel_[level][(current_ >> (slot_bits * level)) & (slots - 1)]);
+            }
+        }
+
+        using std::swap;
+        my_deque<entry> &slot = wheel_[0][current_ & (slots - 1)];
+        swap(draining_, slot);
+        // drained through the spans taken before any callback runs; entries
+        // f schedules for this tick land in the slot, seen on the next pass
+        deque_spans<entry> due = draining_.spans();
+        size_t done = 0;
+        try {
+            for (deque_span<entry> span : {due.first, due.second}) {
+                for (entry &e : span) {
+                    done++;
+                    if (!live_(e.handle)) {
+                        dead_count_--;
+                        continue;
+                    }
+                    free_.push_back(e.handle.index);
+                    generations_[e.handle.index]++;
+                    live_count_--;
+                    fired++;
+                    f(e.handle, e.value);
+                }
+            }
+        } catch (...) {
+            // the rest of the tick stays due, ahead of what f added
+            draining_.consume_front(done);
+            while (!slot.empty()) {
+                draining_.push_back(std::move(slot.front()));
+                slot.pop_front();
+            }
+            swap(draining_, slot);
+            throw;
+        }
+        draining_.consume_front(draining_.size());
+        if (slot.empty()) {
+            current_ = std::min(next_event_(), now + 1);
+        }
+    }
+    return fired;
+}
+
+template<typename T>
+size_t timer_wheel<T>::size() const noexcept {
+    return live_count_;
+}
+
+template<typename T>
+bool timer_wheel<T>::empty() const noexcept {
+    return live_count_ == 0;
+}
+
+template<typename T>
+size_t timer_wheel<T>::stored() const noexcept {
+    size_t res = overflow_.size();
+    for (auto const &level : wheel_) {
+        for (my_deque<entry> const &slot : level) {
+            res += slot.size();
+        }
+    }
+    return res;
+}
+
+template<typename T>
+uint64_t timer_wheel<T>::now() const noexcept {
+    return current_;
+}
+
+template<typename T>
+void timer_wheel<T>::place_(entry &&e) {
+    uint64_t differ = e.deadline ^ current_;
+    for (unsigned level = 0; level != levels; ++level) {
+        if (differ >> (slot_bits * (level + 1)) == 0) {
+            wheel_[level][(e.deadline >> (slot_bits * level)) & (slots - 1)].push_back(std::move(e));
+            return;
+        }
+    }
+    overflow_.push_back(std::move(e));
+}
+
+template<typename T>
+void timer_wheel<T>::cascade_(my_deque<entry> &slot) {
+    using std::swap;
+    my_deque<entry> moving;
+    swap(moving, slot);
+    while (!moving.empty()) {
+        if (live_(moving.front().handle)) {
+            place_(std::move(moving.front()));
+        } else {
+            dead_count_--;
+        }
+        moving.pop_front();
+    }
+}
+
+#endif //EXAM_DEQUE_TIMER_WHEEL_H
@@ -0,0 +1,189 @@
+#ifndef EXAM_DEQUE_WINDOW_AGGREGATOR_H
+#define EXAM_DEQUE_WINDOW_AGGREGATOR_H
+
+#include "my_deque.h"
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+// min and max, as ops for window_aggregator; they select the monotonic
+// deque implementation below
+template<typename T>
+struct agg_min {
+    T operator()(T const &a, T const &b) const {
+        return b < a ? b : a;
+    }
+};
+
+template<typename T>
+struct agg_max {
+    T operator()(T const &a, T const &b) const {
+        return a < b ? b : a;
+    }
+};
+
+// Aggregate of a FIFO window under any associative Op (it need not be
+// commutative nor have an identity), with push and pop O(1) amortized: the
+// two-stacks algorithm kept in one my_deque. Slots [0, split_) hold, for
+// each of the oldest elements, the aggregate from it to the split; slots
+// from split_ on hold the newest elements as pushed, and back_ their
+// aggregate. query() combines the first slot with back_. When pop() uses up
+// the aggregated part, the raw part is folded into suffix aggregates in one
+// backward pass, each element at most once.
+//
+// Elements are not kept: the window only answers query().
+template<typename T, typename Op = std::plus<T>>
+class window_aggregator {
+public:
+    explicit window_aggregator(Op op = Op());
+
+    void push(T const &value);
+    // drops the oldest element; if Op throws here, the window is cleared
+    void pop();
+    // Op over the window from oldest to newest; the window must not be empty
+    T query() const;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    void clear() noexcept;
+
+private:
+    void flip_();
+
+    Op op_;
+    my_deque<T> slots_;
+    size_t split_ = 0;
+    // meaningful while split_ < slots_.size()
+    T back_ = T();
+};
+
+template<typename T, typename Op>
+window_aggregator<T, Op>::window_aggregator(Op op) : op_(std::move(op)) {}
+
+template<typename T, typename Op>
+void window_aggregator<T, Op>::push(T const &value) {
+    T back = split_ == slots_.size() ? value : op_(back_, value);
+    slots_.push_back(value);
+    back_ = std::move(back);
+}
+
+template<typename T, typename Op>
+void window_aggregator<T, Op>::pop() {
+    if (split_ == 0) {
+        flip_();
+    }
+    slots_.pop_front();
+    split_--;
+}
+
+template<typename T, typename Op>
+T window_aggregator<T, Op>::query() const {
+    if (split_ == 0) {
+        return back_;
+    }
+    if (split_ == slots_.size()) {
+        return slots_.front();
+    }
+    return op_(slots_.front(), back_);
+}
+
+template<typename T, typename Op>
+size_t window_aggregator<T, Op>::size() const noexcept {
+    return slots_.size();
+}
+
+template<typename T, typename Op>
+bool window_aggregator<T, Op>::empty() const noexcept {
+    return slots_.empty();
+}
+
+template<typename T, typename Op>
+void window_aggregator<T, Op>::clear() noexcept {
+    slots_.clear();
+    split_ = 0;
+}
+
+template<typename T, typename Op>
+void window_aggregator<T, Op>::flip_() {
+    // a fold that fails halfway leaves neither form, so the window is
+    // emptied rather than left answering with a mix
+    try {
+        for (size_t i = slots_.size() - 1; i-- > 0;) {
+            slots_[i] = op_(slots_[i], slots_[i + 1]);
+        }
+    } catch (...) {
+        clear();
+        throw;
+    }
+    split_ = slots_.size();
+}
+
+// Min and max keep a deque of candidates instead: elements that can still
+// become the extreme of the window, with their sequence numbers, in
+// monotonic order. A push drops the candidates it beats from the back, so
+// the front is always the answer, and a pop drops the front once the
+// element it stands for leaves the window. Both are O(1) amortized with no
+// folding pass, and the candidates are often far fewer than the window.
+template<typename T, typename Better>
+class monotonic_window {
+public:
+    void push(T const &value) {
+        while (!candidates_.empty() && !better_(candidates_.back().value, value)) {
+            candidates_.pop_back();
+        }
+        candidates_.push_back(candidate{value, end_});
+        end_++;
+    }
+
+    void pop() {
+        if (candidates_.front().seq == begin_) {
+            candidates_.pop_front();
+        }
+        begin_++;
+    }
+
+    T query() const {
+        return candidates_.front().value;
+    }
+
+    size_t size() const noexcept {
+        return end_ - begin_;
+    }
+
+    bool empty() const noexcept {
+        return end_ == begin_;
+    }
+
+    void clear() noexcept {
+        candidates_.clear();
+        begin_ = end_;
+    }
+
+private:
+    struct candidate {
+        T value;
+        size_t seq;
+    };
+
+    Better better_;
+    my_deque<candidate> candidates_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+// a candidate survives a newer value only if it is strictly better, so
+// ties keep the newer one, which stays in the window longer
+template<typename T>
+class window_aggregator<T, agg_min<T>> : public monotonic_window<T, std::less<T>> {
+public:
+    explicit window_aggregator(agg_min<T> = agg_min<T>()) {}
+};
+
+template<typename T>
+class window_aggregator<T, agg_max<T>> : public monotonic_window<T, std::greater<T>> {
+public:
+    explicit window_aggregator(agg_max<T> = agg_max<T>()) {}
+};
+
+#endif //EXAM_DEQUE_WINDOW_AGGREGATOR_H